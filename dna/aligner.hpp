@@ -0,0 +1,243 @@
+#pragma once
+
+#include "base.hpp"
+
+#include <concepts>
+#include <memory_resource>
+#include <optional>
+#include <vector>
+
+namespace dna
+{
+
+// Lengths of the divergent region at the start of a pair of windows.
+// Both windows are back in sync immediately after it.
+struct alignment
+{
+	std::size_t a_length;
+	std::size_t b_length;
+};
+
+// An Aligner is handed two windows that disagree at their first base and reports how
+// far into each window the disagreement extends, or nothing if it can't tell
+template<typename T>
+concept Aligner = requires(T aligner, base_span a, base_span b) {
+	{ aligner.align(a, b) } -> std::convertible_to<std::optional<alignment>>;
+};
+
+// # of consecutive matching bases needed to consider two windows back in sync
+static constexpr std::size_t RESYNC_LENGTH = 16;
+
+// Whether a and b agree for the next length bases. Windows shorter than that only
+// count as in sync if they agree all the way to a common end.
+inline bool resyncs(base_span a, base_span b, std::size_t length = RESYNC_LENGTH) noexcept
+{
+	if (a.size() < length || b.size() < length)
+		return a.size() == b.size() && mismatch_offset(a, b) == a.size();
+
+	return mismatch_offset(a, b, length) == length;
+}
+
+// Smallest shift (up to max_shift) that brings the windows back in sync.
+// Positive: skip that many bases of a (bases deleted from b).
+// Negative: skip that many bases of b (bases inserted into b).
+// Zero: no shift works.
+inline long shift_test(base_span a, base_span b, std::size_t max_shift) noexcept
+{
+	for (std::size_t shift = 1; shift <= max_shift; ++shift)
+	{
+		if (shift <= a.size() && resyncs(a.subspan(shift), b))
+			return static_cast<long>(shift);
+		if (shift <= b.size() && resyncs(a, b.subspan(shift)))
+			return -static_cast<long>(shift);
+	}
+
+	return 0;
+}
+
+// Cheap statistics about a divergent window, used to pick an aligner
+struct window_stats
+{
+	std::size_t length = 0;     // bases available in the shorter window
+	std::size_t probe = 0;      // bases examined in lockstep
+	std::size_t mismatches = 0; // lockstep mismatches within the probe
+	long shift = 0;             // shift_test() result, only computed when the window isn't a lone substitution
+
+	double mismatch_density() const noexcept
+	{
+		return probe == 0 ? 0.0 : static_cast<double>(mismatches) / static_cast<double>(probe);
+	}
+
+	bool lone_substitution() const noexcept
+	{
+		return mismatches == 1;
+	}
+};
+
+inline window_stats measure(base_span a, base_span b, std::size_t max_shift)
+{
+	window_stats stats;
+	stats.length = std::min(a.size(), b.size());
+	stats.probe = std::min(stats.length, RESYNC_LENGTH + 1);
+
+	for (std::size_t i = 0; i < stats.probe; ++i)
+		stats.mismatches += (a[i] != b[i]);
+
+	if (!stats.lone_substitution())
+		stats.shift = shift_test(a, b, max_shift);
+
+	return stats;
+}
+
+// The whole window, for when nothing else could find where it resyncs
+inline alignment unaligned(base_span a, base_span b) noexcept
+{
+	return {a.size(), b.size()};
+}
+
+// A single substituted base (SNP): nothing needs aligning
+struct snp_aligner
+{
+	std::optional<alignment> align(base_span a, base_span b) const noexcept
+	{
+		if (a.empty() || b.empty() || !resyncs(a.subspan(1), b.subspan(1)))
+			return std::nullopt;
+
+		return alignment{1, 1};
+	}
+};
+
+// A short insertion or deletion: shift one window against the other
+struct shift_aligner
+{
+	static constexpr std::size_t DEFAULT_MAX_SHIFT = 16;
+
+	std::size_t max_shift = DEFAULT_MAX_SHIFT;
+
+	std::optional<alignment> align(base_span a, base_span b) const noexcept
+	{
+		return align(shift_test(a, b, max_shift));
+	}
+
+	// For a window whose shift_test() has already been run, e.g. by measure()
+	static std::optional<alignment> align(long shift) noexcept
+	{
+		if (shift > 0)
+			return alignment{static_cast<std::size_t>(shift), 0};
+		if (shift < 0)
+			return alignment{0, static_cast<std::size_t>(-shift)};
+
+		return std::nullopt;
+	}
+};
+
+// Anything messier: index the k-mers of b, then find the nearest position pair
+// (smallest combined distance into both windows) where the two agree again.
+// Handles large insertions and deletions as well as clusters of mismatches.
+// The search starts with a small region and grows it geometrically, so the cost
+// is proportional to the size of the divergence rather than of the window.
+class anchor_aligner
+{
+public:
+	static constexpr std::size_t KMER = 16;
+	static constexpr std::size_t VERIFY_LENGTH = 2 * RESYNC_LENGTH;
+	static constexpr std::size_t MIN_SEARCH = 256;
+	static constexpr std::size_t SEARCH_GROWTH = 8;
+
+	anchor_aligner() = default;
+
+	// The hash chains come from resource
+	explicit anchor_aligner(std::pmr::memory_resource* resource) :
+			keys_(resource),
+			heads_(resource),
+			next_(resource)
+	{ }
+
+	std::optional<alignment> align(base_span a, base_span b)
+	{
+		for (std::size_t span = MIN_SEARCH; ; span *= SEARCH_GROWTH)
+		{
+			if (auto found = search(a, b, span))
+				return found;
+
+			if (span >= a.size() && span >= b.size())
+				return std::nullopt;
+		}
+	}
+
+private:
+	static constexpr std::uint32_t EMPTY = UINT32_MAX;
+
+	// Hash chains over the k-mers of b, reused between calls
+	std::pmr::vector<std::uint32_t> keys_;
+	std::pmr::vector<std::uint32_t> heads_;
+	std::pmr::vector<std::uint32_t> next_;
+
+	static std::uint32_t roll(std::uint32_t key, base b) noexcept
+	{
+		return (key << 2) | static_cast<std::uint32_t>(b);
+	}
+
+	static std::size_t slot(std::uint32_t key, int bits) noexcept
+	{
+		return static_cast<std::size_t>((key * 0x9E3779B1u) >> (32 - bits));
+	}
+
+	// Looks for anchors starting within the first span bases of each window.
+	// Candidates are verified against the full windows.
+	std::optional<alignment> search(base_span a, base_span b, std::size_t span)
+	{
+		static_assert(KMER * 2 == 32, "k-mers must exactly fill a 32-bit key");
+
+		if (a.size() < KMER || b.size() < KMER)
+			return std::nullopt;
+
+		const std::size_t positions = std::min(span, b.size() - KMER + 1);
+		const std::size_t a_positions = std::min(span, a.size() - KMER + 1);
+		const int bits = std::max(4, static_cast<int>(std::bit_width(positions * 2)) - 1);
+
+		keys_.resize(positions);
+		next_.resize(positions);
+		heads_.assign(std::size_t{1} << bits, EMPTY);
+
+		std::uint32_t key = 0;
+		for (std::size_t i = 0; i < KMER - 1; ++i)
+			key = roll(key, b[i]);
+		for (std::size_t p = 0; p < positions; ++p)
+			keys_[p] = key = roll(key, b[p + KMER - 1]);
+
+		// Insert back to front so that every chain is in ascending position order
+		for (std::size_t p = positions; p-- > 0;)
+		{
+			auto& head = heads_[slot(keys_[p], bits)];
+			next_[p] = head;
+			head = static_cast<std::uint32_t>(p);
+		}
+
+		std::optional<alignment> best;
+		std::size_t best_distance = SIZE_MAX;
+
+		key = 0;
+		for (std::size_t i = 0; i < KMER - 1; ++i)
+			key = roll(key, a[i]);
+
+		for (std::size_t da = 0; da < a_positions && da < best_distance; ++da)
+		{
+			key = roll(key, a[da + KMER - 1]);
+
+			for (auto db = heads_[slot(key, bits)]; db != EMPTY && da + db < best_distance; db = next_[db])
+			{
+				if (keys_[db] == key && resyncs(a.subspan(da), b.subspan(db), VERIFY_LENGTH))
+				{
+					best = alignment{da, db};
+					best_distance = da + db;
+					break;
+				}
+			}
+		}
+
+		return best;
+	}
+};
+
+}
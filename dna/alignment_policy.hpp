@@ -0,0 +1,159 @@
+#pragma once
+
+#include "aligner.hpp"
+#include "banded_aligner.hpp"
+
+namespace dna
+{
+
+// A policy decides which Aligner handles a window, and always produces an answer. The
+// windows it is handed disagree at their first base, so the answer has to cover at least
+// one base of either and no more than is in each window; that is how the scan moves on.
+// compare() treats an empty answer (a policy that gave up) as a mismatch of the first base
+// of both, and cuts an answer that is too long down to the windows.
+template<typename T>
+concept AlignmentPolicy = requires(T policy, base_span a, base_span b) {
+	{ policy.resolve(a, b) } -> std::convertible_to<alignment>;
+};
+
+// How a policy resolved the windows it was handed, by the aligner that managed it.
+// Policies that count them (CountingPolicy) hand them out through windows().
+struct window_counts
+{
+	std::size_t snp = 0;
+	std::size_t shift = 0;
+	std::size_t banded = 0;
+	// The general purpose aligner, or fixed_policy's only one
+	std::size_t fallback = 0;
+	// No aligner managed, so the whole window was reported
+	std::size_t unaligned = 0;
+
+	std::size_t total() const noexcept
+	{
+		return snp + shift + banded + fallback + unaligned;
+	}
+
+	window_counts& operator+=(const window_counts& other) noexcept
+	{
+		snp += other.snp;
+		shift += other.shift;
+		banded += other.banded;
+		fallback += other.fallback;
+		unaligned += other.unaligned;
+		return *this;
+	}
+
+	window_counts& operator-=(const window_counts& other) noexcept
+	{
+		snp -= other.snp;
+		shift -= other.shift;
+		banded -= other.banded;
+		fallback -= other.fallback;
+		unaligned -= other.unaligned;
+		return *this;
+	}
+
+	bool operator==(const window_counts&) const = default;
+};
+
+template<typename T>
+concept CountingPolicy = AlignmentPolicy<T> && requires(const T policy) {
+	{ policy.windows() } -> std::convertible_to<window_counts>;
+};
+
+// Always use the same aligner, falling back to the whole window if it fails
+template<Aligner A>
+class fixed_policy
+{
+	A aligner_;
+	window_counts windows_;
+public:
+	fixed_policy(A aligner = {}) :
+			aligner_(std::move(aligner)),
+			windows_()
+	{ }
+
+	alignment resolve(base_span a, base_span b)
+	{
+		if (auto result = aligner_.align(a, b))
+		{
+			++windows_.fallback;
+			return *result;
+		}
+
+		++windows_.unaligned;
+		return unaligned(a, b);
+	}
+
+	const window_counts& windows() const noexcept
+	{
+		return windows_;
+	}
+};
+
+// Measure the window and use the cheapest aligner that can handle it:
+//  - a lone substitution needs no alignment at all
+//  - a pure shift is a short indel
+//  - a few scattered mismatches go to the banded aligner
+//  - anything else, or anything the cheaper aligners fail on, goes to Fallback
+template<Aligner Fallback = anchor_aligner, Aligner Banded = banded_aligner<>>
+class adaptive_policy
+{
+	// Windows at most this dense with mismatches are worth trying with the banded aligner.
+	// Two unrelated sequences mismatch about 3/4 of the time.
+	static constexpr double BANDED_MAX_DENSITY = 0.25;
+
+	snp_aligner snp_;
+	shift_aligner shift_;
+	Banded banded_;
+	Fallback fallback_;
+	window_counts windows_;
+public:
+	adaptive_policy() = default;
+
+	// For a Fallback with tables of its own (like anchor_aligner), taken from resource
+	explicit adaptive_policy(std::pmr::memory_resource* resource)
+		requires std::constructible_from<Fallback, std::pmr::memory_resource*> :
+			fallback_(resource)
+	{ }
+
+	alignment resolve(base_span a, base_span b)
+	{
+		auto stats = measure(a, b, shift_.max_shift);
+
+		std::optional<alignment> result;
+		std::size_t* counter = &windows_.fallback;
+		if (stats.lone_substitution())
+		{
+			result = snp_.align(a, b);
+			counter = &windows_.snp;
+		}
+		else if (stats.shift != 0)
+		{
+			// measure() already found the shift
+			result = shift_aligner::align(stats.shift);
+			counter = &windows_.shift;
+		}
+		else if (stats.mismatch_density() <= BANDED_MAX_DENSITY)
+		{
+			result = banded_.align(a, b);
+			counter = &windows_.banded;
+		}
+
+		if (!result)
+		{
+			result = fallback_.align(a, b);
+			counter = result ? &windows_.fallback : &windows_.unaligned;
+		}
+
+		++*counter;
+		return result.value_or(unaligned(a, b));
+	}
+
+	const window_counts& windows() const noexcept
+	{
+		return windows_;
+	}
+};
+
+}
@@ -0,0 +1,124 @@
+#pragma once
+
+#include "comparator.hpp"
+
+#include <compare>
+#include <optional>
+#include <stdexcept>
+
+namespace dna
+{
+	// Where a base is stored in a HelixStream: seek() to byte, and the base is the two bits
+	// at (value >> bit) & 0x3
+	struct StreamPosition
+	{
+		size_t base_idx;
+		long byte;
+		unsigned bit;
+
+		bool operator==(const StreamPosition&) const = default;
+	};
+
+	// A position measured from the end of the telomeres at the front of a chromosome. Unlike
+	// a base index, which depends on how much telomere each person has (or the sequencer
+	// kept), it refers to the same place in everyone.
+	struct AnchoredPosition
+	{
+		size_t chromosome_idx;
+		size_t offset;
+
+		auto operator<=>(const AnchoredPosition&) const = default;
+	};
+
+	// The end of the front telomeres of one helix, which AnchoredPositions are measured from
+	class TelomereAnchor
+	{
+		size_t data_start_;
+
+		explicit TelomereAnchor(size_t data_start) : data_start_{data_start}
+		{}
+
+	public:
+		// One whole TTAGGG repeat
+		static constexpr size_t DEFAULT_MIN_TELOMERE = 6;
+
+		// Finds the anchor by reading only the telomeres themselves. Returns nothing if fewer
+		// than min_telomere bases of telomere are left, which is known as soon as the first
+		// bases that don't fit the repeat are read.
+		template <HelixStream H>
+		static std::optional<TelomereAnchor> find(H& helix, size_t min_telomere = DEFAULT_MIN_TELOMERE)
+		{
+			const size_t data_start = Comparator::getDataStart(helix);
+			if (data_start == 0 || data_start < min_telomere)
+			{
+				return std::nullopt;
+			}
+			return TelomereAnchor(data_start);
+		}
+
+		// Base index of the first base after the telomeres
+		size_t dataStart() const noexcept
+		{
+			return data_start_;
+		}
+
+		// Where the base offset bases past the telomeres is stored
+		StreamPosition resolve(size_t offset) const noexcept
+		{
+			const size_t base_idx = data_start_ + offset;
+			return StreamPosition{
+				base_idx,
+				static_cast<long>(base_idx / packed_size::value),
+				static_cast<unsigned>(2 * (packed_size::value - 1 - base_idx % packed_size::value)),
+			};
+		}
+
+		// The offset of a base index past the telomeres. Throws std::invalid_argument for
+		// bases within the telomeres.
+		size_t offsetOf(size_t base_idx) const
+		{
+			if (base_idx < data_start_)
+			{
+				throw std::invalid_argument("position is within the telomeres");
+			}
+			return base_idx - data_start_;
+		}
+	};
+
+	// Anchors a base index of one of person's chromosomes, for resolving in other people.
+	// Throws std::invalid_argument if the chromosome's telomeres are too degraded to anchor
+	// to, or the base is within them.
+	template <Person P>
+	AnchoredPosition anchor(const P& person, size_t chromosome_idx, size_t base_idx,
+			size_t min_telomere = TelomereAnchor::DEFAULT_MIN_TELOMERE)
+	{
+		auto helix = person.chromosome(chromosome_idx);
+		auto telomere = TelomereAnchor::find(helix, min_telomere);
+		if (!telomere)
+		{
+			throw std::invalid_argument("chromosome has no telomere to anchor to");
+		}
+		return AnchoredPosition{chromosome_idx, telomere->offsetOf(base_idx)};
+	}
+
+	// Where position is stored in person, or nothing if the chromosome's telomeres are too
+	// degraded to anchor to or the chromosome is too short to contain it
+	template <Person P>
+	std::optional<StreamPosition> resolve(const P& person, AnchoredPosition position,
+			size_t min_telomere = TelomereAnchor::DEFAULT_MIN_TELOMERE)
+	{
+		auto helix = person.chromosome(position.chromosome_idx);
+		auto telomere = TelomereAnchor::find(helix, min_telomere);
+		if (!telomere)
+		{
+			return std::nullopt;
+		}
+
+		auto ret = telomere->resolve(position.offset);
+		if (ret.base_idx >= static_cast<size_t>(helix.size()) * packed_size::value)
+		{
+			return std::nullopt;
+		}
+		return ret;
+	}
+}
@@ -0,0 +1,298 @@
+#pragma once
+
+#include "aligner.hpp"
+#include "scratch_arena.hpp"
+
+#include <climits>
+
+namespace dna
+{
+
+// Scores used by banded_aligner. A gap of length L scores gap_open + L * gap_extend.
+// Passed as a template parameter so every score is a constant in the DP inner loop.
+struct scoring_scheme
+{
+	int match = 2;
+	int mismatch = -4;
+	int gap_open = -4;
+	int gap_extend = -2;
+};
+
+enum class edit_op : std::uint8_t
+{
+	match,
+	substitution,
+	insertion, // bases present only in b
+	deletion,  // bases present only in a
+};
+
+// A run of identical edit operations, with offsets into the aligned sequences
+struct edit_run
+{
+	edit_op op;
+	std::size_t a_offset;
+	std::size_t b_offset;
+	std::size_t length;
+
+	std::size_t a_length() const noexcept
+	{
+		return op == edit_op::insertion ? 0 : length;
+	}
+
+	std::size_t b_length() const noexcept
+	{
+		return op == edit_op::deletion ? 0 : length;
+	}
+};
+
+// Affine-gap Needleman-Wunsch restricted to a band of diagonals around the main one.
+// Cheap and predictable for windows known to differ by a little: cost is
+// length * (2 * band + 1) cells. DP rows and the traceback matrix live in a scratch
+// arena that is reused between alignments.
+template<scoring_scheme Scoring = scoring_scheme{}>
+class banded_aligner
+{
+	// Traceback bits stored for every cell
+	static constexpr std::uint8_t FROM_DIAGONAL = 0;
+	static constexpr std::uint8_t FROM_INSERTION = 1;
+	static constexpr std::uint8_t FROM_DELETION = 2;
+	static constexpr std::uint8_t SOURCE_MASK = 3;
+	static constexpr std::uint8_t INSERTION_EXTENDED = 4;
+	static constexpr std::uint8_t DELETION_EXTENDED = 8;
+
+	static constexpr int NEG_INF = INT_MIN / 4;
+	static constexpr int GAP_START = Scoring.gap_open + Scoring.gap_extend;
+
+	std::size_t band_;
+	std::size_t max_length_;
+	scratch_arena arena_;
+	std::vector<edit_run> runs_;
+
+public:
+	static constexpr std::size_t DEFAULT_BAND = 16;
+	static constexpr std::size_t DEFAULT_LENGTH = 192;
+
+	explicit banded_aligner(std::size_t band = DEFAULT_BAND, std::size_t max_length = DEFAULT_LENGTH) :
+			band_(band),
+			max_length_(max_length),
+			arena_(),
+			runs_()
+	{ }
+
+	// Aligns all of a against all of b. Returns the score, or nothing if the two lengths
+	// differ by more than the band. The alignment is available from runs() afterwards.
+	std::optional<int> global(base_span a, base_span b)
+	{
+		return run(a, b, false);
+	}
+
+	std::span<const edit_run> runs() const noexcept
+	{
+		return runs_;
+	}
+
+	// Aligns the start of both windows with free trailing gaps. The divergent region
+	// ends with the last run that isn't a match, and must be followed by a resync.
+	std::optional<alignment> align(base_span a, base_span b)
+	{
+		if (!run(a.first(std::min(max_length_, a.size())), b.first(std::min(max_length_, b.size())), true))
+			return std::nullopt;
+
+		auto last = std::find_if(runs_.rbegin(), runs_.rend(), [](const edit_run& r) { return r.op != edit_op::match; });
+		if (last == runs_.rend())
+			return std::nullopt;
+
+		const std::size_t a_len = last->a_offset + last->a_length();
+		const std::size_t b_len = last->b_offset + last->b_length();
+		if (!resyncs(a.subspan(a_len), b.subspan(b_len)))
+			return std::nullopt;
+
+		return alignment{a_len, b_len};
+	}
+
+private:
+	static constexpr int score(base x, base y) noexcept
+	{
+		return x == y ? Scoring.match : Scoring.mismatch;
+	}
+
+	std::optional<int> run(base_span a, base_span b, bool free_end)
+	{
+		const std::size_t n = a.size();
+		const std::size_t m = b.size();
+		const long w = static_cast<long>(band_);
+		const std::size_t width = 2 * band_ + 1;
+
+		if (!free_end && (n > m ? n - m : m - n) > band_)
+			return std::nullopt;
+
+		arena_.reset();
+		// One extra cell per row so that looking up-and-right off the band reads NEG_INF
+		auto h_prev = arena_.allocate<int>(width + 1);
+		auto h_cur = arena_.allocate<int>(width + 1);
+		auto f_prev = arena_.allocate<int>(width + 1);
+		auto f_cur = arena_.allocate<int>(width + 1);
+		auto trace = arena_.allocate<std::uint8_t>((n + 1) * width);
+
+		// Cell (i, j) of the full matrix is stored at row i, index j - i + band
+		for (std::size_t k = 0; k <= width; ++k)
+		{
+			const long j = static_cast<long>(k) - w;
+			const bool in_band = k < width && j >= 0 && j <= static_cast<long>(m);
+
+			h_prev[k] = !in_band ? NEG_INF : (j == 0 ? 0 : Scoring.gap_open + static_cast<int>(j) * Scoring.gap_extend);
+			f_prev[k] = NEG_INF;
+			if (k < width)
+				trace[k] = FROM_INSERTION | (j > 1 ? INSERTION_EXTENDED : 0);
+		}
+
+		int best = NEG_INF;
+		std::size_t best_i = 0;
+		std::size_t best_j = 0;
+		auto consider = [&](int value, std::size_t i, std::size_t j) {
+			if (value > best)
+			{
+				best = value;
+				best_i = i;
+				best_j = j;
+			}
+		};
+
+		if (free_end)
+		{
+			for (std::size_t k = 0; k < width; ++k)
+			{
+				const long j = static_cast<long>(k) - w;
+				if (j >= 0 && j <= static_cast<long>(m) && (n == 0 || static_cast<std::size_t>(j) == m))
+					consider(h_prev[k], 0, static_cast<std::size_t>(j));
+			}
+		}
+
+		for (std::size_t i = 1; i <= n; ++i)
+		{
+			int e = NEG_INF;
+			h_cur[width] = NEG_INF;
+			f_cur[width] = NEG_INF;
+			auto* row_trace = trace.data() + i * width;
+
+			for (std::size_t k = 0; k < width; ++k)
+			{
+				const long j = static_cast<long>(i + k) - w;
+				if (j < 0 || j > static_cast<long>(m))
+				{
+					h_cur[k] = NEG_INF;
+					f_cur[k] = NEG_INF;
+					e = NEG_INF;
+					continue;
+				}
+
+				std::uint8_t bits = 0;
+
+				// Insertion: gap in a, coming from (i, j - 1)
+				const int e_open = (k > 0 ? h_cur[k - 1] : NEG_INF) + GAP_START;
+				const int e_extend = e + Scoring.gap_extend;
+				e = std::max(e_open, e_extend);
+				bits |= (e_extend > e_open) ? INSERTION_EXTENDED : 0;
+
+				// Deletion: gap in b, coming from (i - 1, j)
+				const int f_open = h_prev[k + 1] + GAP_START;
+				const int f_extend = f_prev[k + 1] + Scoring.gap_extend;
+				const int f = std::max(f_open, f_extend);
+				bits |= (f_extend > f_open) ? DELETION_EXTENDED : 0;
+				f_cur[k] = f;
+
+				int h = j > 0 ? h_prev[k] + score(a[i - 1], b[static_cast<std::size_t>(j) - 1]) : NEG_INF;
+				std::uint8_t source = FROM_DIAGONAL;
+				if (e > h)
+				{
+					h = e;
+					source = FROM_INSERTION;
+				}
+				if (f > h)
+				{
+					h = f;
+					source = FROM_DELETION;
+				}
+
+				h_cur[k] = h;
+				row_trace[k] = bits | source;
+
+				if (free_end && (i == n || static_cast<std::size_t>(j) == m))
+					consider(h, i, static_cast<std::size_t>(j));
+			}
+
+			std::swap(h_prev, h_cur);
+			std::swap(f_prev, f_cur);
+		}
+
+		if (!free_end)
+		{
+			best = h_prev[m + band_ - n];
+			best_i = n;
+			best_j = m;
+		}
+
+		if (best <= NEG_INF / 2)
+			return std::nullopt;
+
+		traceback(a, b, trace, best_i, best_j);
+		return best;
+	}
+
+	void traceback(base_span a, base_span b, std::span<const std::uint8_t> trace, std::size_t i, std::size_t j)
+	{
+		const std::size_t width = 2 * band_ + 1;
+
+		// Walk back from the end cell, collecting runs in reverse
+		runs_.clear();
+		auto push = [this](edit_op op) {
+			if (!runs_.empty() && runs_.back().op == op)
+				++runs_.back().length;
+			else
+				runs_.push_back(edit_run{op, 0, 0, 1});
+		};
+
+		std::uint8_t state = FROM_DIAGONAL;
+		while (i > 0 || j > 0)
+		{
+			const std::uint8_t bits = trace[i * width + (j + band_ - i)];
+
+			if (state == FROM_DIAGONAL)
+			{
+				state = bits & SOURCE_MASK;
+				if (state == FROM_DIAGONAL)
+				{
+					push(a[i - 1] == b[j - 1] ? edit_op::match : edit_op::substitution);
+					--i;
+					--j;
+				}
+			}
+			else if (state == FROM_INSERTION)
+			{
+				push(edit_op::insertion);
+				--j;
+				state = (bits & INSERTION_EXTENDED) ? FROM_INSERTION : FROM_DIAGONAL;
+			}
+			else
+			{
+				push(edit_op::deletion);
+				--i;
+				state = (bits & DELETION_EXTENDED) ? FROM_DELETION : FROM_DIAGONAL;
+			}
+		}
+
+		std::reverse(runs_.begin(), runs_.end());
+
+		std::size_t a_offset = 0;
+		std::size_t b_offset = 0;
+		for (auto& r : runs_)
+		{
+			r.a_offset = a_offset;
+			r.b_offset = b_offset;
+			a_offset += r.a_length();
+			b_offset += r.b_length();
+		}
+	}
+};
+
+}
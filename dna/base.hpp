@@ -1,13 +1,18 @@
 #pragma once
 
 #include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <algorithm>
 #include <array>
+#include <bit>
 #include <ostream>
+#include <span>
 
 namespace dna
 {
 
-enum class base
+enum class base : std::uint8_t
 {
 	adenine,
 	cytosine,
@@ -35,9 +40,10 @@ constexpr char to_char(base value)
 	}
 }
 
+// A <-> T and C <-> G, for each of the four bases in a byte
 constexpr std::byte complement_packed(std::byte packed)
 {
-	return packed ^ static_cast<std::byte>(0);
+	return packed ^ static_cast<std::byte>(0xFF);
 }
 
 constexpr base complement(enum base base)
@@ -65,6 +71,38 @@ constexpr packed_bases unpack(std::byte b)
 			static_cast<dna::base>(b & std::byte{0x3}) });
 }
 
+// Unpacked, contiguous run of bases (one base per byte)
+using base_span = std::span<const base>;
+
+// Number of leading bases that a and b have in common, examining at most limit bases
+inline std::size_t mismatch_offset(base_span a, base_span b, std::size_t limit = SIZE_MAX) noexcept
+{
+	const std::size_t n = std::min({a.size(), b.size(), limit});
+	std::size_t i = 0;
+
+	// Compare a machine word of bases at a time; the first differing byte is the mismatch
+	for (; i + sizeof(std::uint64_t) <= n; i += sizeof(std::uint64_t))
+	{
+		std::uint64_t word_a;
+		std::uint64_t word_b;
+		std::memcpy(&word_a, a.data() + i, sizeof(word_a));
+		std::memcpy(&word_b, b.data() + i, sizeof(word_b));
+
+		if (auto diff = word_a ^ word_b; diff != 0)
+		{
+			if constexpr (std::endian::native == std::endian::little)
+				return i + static_cast<std::size_t>(std::countr_zero(diff)) / 8;
+			else
+				return i + static_cast<std::size_t>(std::countl_zero(diff)) / 8;
+		}
+	}
+
+	while (i < n && a[i] == b[i])
+		++i;
+
+	return i;
+}
+
 inline std::ostream& operator<<(std::ostream& os, base v)
 {
 	switch (v)
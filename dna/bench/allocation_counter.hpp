@@ -0,0 +1,12 @@
+#pragma once
+
+#include <cstddef>
+
+// Counts every call to the global operator new made by the benchmark binary, so that
+// benchmarks can report how many allocations an operation makes
+namespace bench
+{
+
+std::size_t allocations() noexcept;
+
+}
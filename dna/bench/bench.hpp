@@ -0,0 +1,59 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <thread>
+#include <benchmark/benchmark.h>
+#include "allocation_counter.hpp"
+#include "perf_counters.hpp"
+
+namespace bench
+{
+
+// Sizes in bases, from a few KB of packed data up to about the length of chromosome 1
+inline void chromosome_sizes(benchmark::internal::Benchmark* b)
+{
+	b->RangeMultiplier(64)->Range(1 << 12, 1 << 28)->Unit(benchmark::kMicrosecond);
+}
+
+// Reports allocations per iteration, counted since allocations_before, and whatever hardware
+// counters could be read. If each iteration processed a packed sequence of bases, also
+// reports time per base and bytes per second, and the counters are per base rather than
+// per iteration.
+inline void report(benchmark::State& state, std::size_t bases, std::size_t allocations_before,
+		const perf_counters::reading& perf = {})
+{
+	using benchmark::Counter;
+
+	const auto allocations = static_cast<double>(bench::allocations() - allocations_before);
+	state.counters["allocs"] = Counter(allocations, Counter::kAvgIterations);
+
+	if (bases > 0)
+	{
+		state.SetBytesProcessed(static_cast<std::int64_t>(state.iterations() * bases / 4));
+		state.counters["bases"] = static_cast<double>(bases);
+		state.counters["time_per_base"] = Counter(static_cast<double>(bases), Counter::kIsIterationInvariantRate | Counter::kInvert);
+	}
+
+	const double per = static_cast<double>(state.iterations()) * static_cast<double>(bases > 0 ? bases : 1);
+	for (std::size_t i = 0; i < perf_counters::COUNT; ++i)
+	{
+		if (const auto value = perf[static_cast<perf_counters::counter>(i)])
+			state.counters[std::string(perf_counters::NAMES[i]) + (bases > 0 ? "_per_base" : "")] = *value / per;
+	}
+	if (const auto ipc = perf.ipc())
+		state.counters["ipc"] = *ipc;
+}
+
+struct genome_options
+{
+	// Fraction of the real genome's length to compare
+	double scale = 1.0;
+	// Comparisons are run with 1, 2, 4, ... and finally this many threads
+	std::size_t max_threads = std::thread::hardware_concurrency();
+};
+
+// Registered at run time, since the thread counts are only known then
+void register_genome_benchmarks(const genome_options& options);
+
+}
@@ -0,0 +1,290 @@
+#include "bench.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <map>
+#include <memory>
+#include <numeric>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+#include <comparator.hpp>
+#include <helix_cursor.hpp>
+#include <scratch_arena.hpp>
+#include <trace.hpp>
+#include "mutation_simulator.hpp"
+#include "procedural_stream.hpp"
+
+// Whole-genome person-to-person comparisons, chromosomes shared between 1, 2, 4, ... threads,
+// with the time split into phases:
+//  - I/O: inside the streams' read() and seek()
+//  - telomeres: finding the data range of both helices, less its I/O
+//  - screening: the lockstep scan, less its I/O and alignment
+//  - alignment: inside the alignment policy
+// Phase times are summed over threads, so they add up to more than the latency when there
+// is more than one.
+//
+// Strong scaling compares the same genome with more threads; weak scaling gives each thread
+// the same share of the genome, so the full genome is only compared at the most threads.
+
+namespace
+{
+
+using bench_clock = std::chrono::steady_clock;
+
+double since(bench_clock::time_point start)
+{
+	return std::chrono::duration<double>(bench_clock::now() - start).count();
+}
+
+// Seconds spent in one chromosome's comparison
+struct phase_times
+{
+	double total = 0;
+	double io = 0;
+	double telomeres = 0;
+	double screening = 0;
+	double alignment = 0;
+};
+
+// Adds the time spent reading and seeking to a running total
+template<dna::HelixStream H>
+class timed_stream
+{
+	H helix_;
+	double* seconds_;
+
+public:
+	timed_stream(H helix, double& seconds) :
+			helix_(std::move(helix)),
+			seconds_(&seconds)
+	{ }
+
+	void seek(long offset)
+	{
+		const auto start = bench_clock::now();
+		helix_.seek(offset);
+		*seconds_ += since(start);
+	}
+
+	long size() const
+	{
+		return static_cast<long>(helix_.size());
+	}
+
+	auto read()
+	{
+		const auto start = bench_clock::now();
+		auto seq = helix_.read();
+		*seconds_ += since(start);
+		return seq;
+	}
+};
+
+// Adds the time spent resolving windows to a running total
+template<dna::AlignmentPolicy Policy = dna::adaptive_policy<>>
+class timed_policy
+{
+	Policy policy_;
+
+public:
+	double seconds = 0;
+
+	dna::alignment resolve(dna::base_span a, dna::base_span b)
+	{
+		const auto start = bench_clock::now();
+		auto result = policy_.resolve(a, b);
+		seconds += since(start);
+		return result;
+	}
+};
+
+// The same steps as ComparisonContext::compareChromosome, timed one at a time
+template<dna::Person PA, dna::Person PB>
+phase_times compare_chromosome(std::size_t chromosome_idx, const PA& a, const PB& b, dna::scratch_arena& scratch,
+		timed_policy<>& policy, std::size_t& differences)
+{
+	DNA_TRACE_SCOPE("chromosome", chromosome_idx);
+	phase_times times{};
+	const auto start = bench_clock::now();
+	policy.seconds = 0;
+	scratch.reset();
+
+	timed_stream helix_a(a.chromosome(chromosome_idx), times.io);
+	timed_stream helix_b(b.chromosome(chromosome_idx), times.io);
+
+	std::pair<std::size_t, std::size_t> range_a;
+	std::pair<std::size_t, std::size_t> range_b;
+	{
+		DNA_TRACE_SCOPE("telomeres", chromosome_idx);
+		range_a = dna::Comparator::getDataRange(helix_a, &scratch);
+		range_b = dna::Comparator::getDataRange(helix_b, &scratch);
+	}
+	const auto [a_start, a_end] = range_a;
+	const auto [b_start, b_end] = range_b;
+	times.telomeres = since(start) - times.io;
+
+	const auto scan = bench_clock::now();
+	const double scan_io = times.io;
+	dna::helix_cursor cursor_a(helix_a, a_start, a_end, &scratch);
+	dna::helix_cursor cursor_b(helix_b, b_start, b_end, &scratch);
+	dna::Comparator::compareRange(chromosome_idx, cursor_a, cursor_b, [&](const dna::Difference&) { ++differences; }, {}, policy);
+
+	times.alignment = policy.seconds;
+	times.screening = since(scan) - (times.io - scan_io) - times.alignment;
+	times.total = since(start);
+	return times;
+}
+
+// A person and a copy of them with the default mix of mutations
+struct genome_pair
+{
+	procedural_person a;
+	mutated_person<procedural_person> b;
+
+	explicit genome_pair(double scale) :
+			a(1, 1, procedural_person::sex::x, scale),
+			b(a, 2)
+	{ }
+};
+
+// Generating the ground truth for a full genome takes a while, so each scale is only built
+// once and kept for the rest of the run
+const genome_pair& people(double scale)
+{
+	static std::map<double, std::unique_ptr<genome_pair>> cache;
+	auto& entry = cache[scale];
+	if (!entry)
+		entry = std::make_unique<genome_pair>(scale);
+	return *entry;
+}
+
+// Zero padded, so that counters sort in order
+std::string chromosome_name(std::size_t idx)
+{
+	if (idx >= 22)
+		return "chrX";
+	return (idx < 9 ? "chr0" : "chr") + std::to_string(idx + 1);
+}
+
+void genome_latency(benchmark::State& state, double scale, std::size_t threads, double* baseline, bool weak)
+{
+	const genome_pair* built = nullptr;
+	try
+	{
+		built = &people(scale);
+	}
+	catch (const std::invalid_argument& e)
+	{
+		state.SkipWithError(e.what());
+		return;
+	}
+	const auto& pair = *built;
+	const std::size_t chromosomes = pair.a.chromosomes();
+
+	// Longest first, so that no thread is left with a big one at the end
+	std::vector<std::size_t> order(chromosomes);
+	std::iota(order.begin(), order.end(), 0);
+	std::stable_sort(order.begin(), order.end(),
+			[&](std::size_t l, std::size_t r) { return pair.a.chromosome(l).size() > pair.a.chromosome(r).size(); });
+
+	std::vector<phase_times> sums(chromosomes);
+	std::size_t differences = 0;
+	double latency = 0;
+
+	const auto allocations = bench::allocations();
+	for (auto _ : state)
+	{
+		std::vector<phase_times> times(chromosomes);
+		std::vector<std::size_t> found(threads);
+		std::atomic<std::size_t> next{0};
+
+		auto work = [&](std::size_t worker) {
+			dna::scratch_arena scratch;
+			timed_policy<> policy;
+			for (std::size_t i = next++; i < chromosomes; i = next++)
+				times[order[i]] = compare_chromosome(order[i], pair.a, pair.b, scratch, policy, found[worker]);
+		};
+
+		const auto start = bench_clock::now();
+		{
+			std::vector<std::jthread> workers;
+			for (std::size_t t = 1; t < threads; ++t)
+				workers.emplace_back(work, t);
+			work(0);
+		}
+		latency += since(start);
+
+		for (std::size_t i = 0; i < chromosomes; ++i)
+		{
+			sums[i].total += times[i].total;
+			sums[i].io += times[i].io;
+			sums[i].telomeres += times[i].telomeres;
+			sums[i].screening += times[i].screening;
+			sums[i].alignment += times[i].alignment;
+		}
+		differences += std::accumulate(found.begin(), found.end(), std::size_t{0});
+	}
+
+	std::size_t bases = 0;
+	for (std::size_t i = 0; i < chromosomes; ++i)
+		bases += static_cast<std::size_t>(pair.a.chromosome(i).size()) * dna::packed_size::value;
+	bench::report(state, bases, allocations);
+
+	using benchmark::Counter;
+	auto average = [](double value) { return Counter(value, Counter::kAvgIterations); };
+
+	phase_times phases{};
+	for (std::size_t i = 0; i < chromosomes; ++i)
+	{
+		state.counters[chromosome_name(i)] = average(sums[i].total);
+		phases.io += sums[i].io;
+		phases.telomeres += sums[i].telomeres;
+		phases.screening += sums[i].screening;
+		phases.alignment += sums[i].alignment;
+	}
+	state.counters["io"] = average(phases.io);
+	state.counters["telomeres"] = average(phases.telomeres);
+	state.counters["screening"] = average(phases.screening);
+	state.counters["alignment"] = average(phases.alignment);
+	state.counters["differences"] = average(static_cast<double>(differences));
+	state.counters["threads"] = static_cast<double>(threads);
+
+	// The single thread run of each kind comes first and sets the baseline
+	latency /= static_cast<double>(state.iterations());
+	if (threads == 1)
+		*baseline = latency;
+	if (*baseline > 0)
+		state.counters["efficiency"] = weak ? *baseline / latency : *baseline / (latency * static_cast<double>(threads));
+}
+
+}
+
+void bench::register_genome_benchmarks(const genome_options& options)
+{
+	static double strong_baseline = 0;
+	static double weak_baseline = 0;
+
+	const std::size_t max_threads = std::max<std::size_t>(options.max_threads, 1);
+	std::vector<std::size_t> thread_counts;
+	for (std::size_t t = 1; t < max_threads; t *= 2)
+		thread_counts.push_back(t);
+	thread_counts.push_back(max_threads);
+
+	for (auto threads : thread_counts)
+	{
+		benchmark::RegisterBenchmark(("BM_genome_latency/strong/threads:" + std::to_string(threads)).c_str(),
+				genome_latency, options.scale, threads, &strong_baseline, false)
+				->Iterations(1)->UseRealTime()->Unit(benchmark::kMillisecond);
+	}
+
+	for (auto threads : thread_counts)
+	{
+		const double scale = options.scale * static_cast<double>(threads) / static_cast<double>(max_threads);
+		benchmark::RegisterBenchmark(("BM_genome_latency/weak/threads:" + std::to_string(threads)).c_str(),
+				genome_latency, scale, threads, &weak_baseline, true)
+				->Iterations(1)->UseRealTime()->Unit(benchmark::kMillisecond);
+	}
+}
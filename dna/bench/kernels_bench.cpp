@@ -0,0 +1,516 @@
+#include "bench.hpp"
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstring>
+#include <fstream>
+#include <memory>
+#include <memory_resource>
+#include <ostream>
+#include <span>
+#include <streambuf>
+#include <string>
+#include <thread>
+#include <vector>
+#include <chunk_pool.hpp>
+#include <comparator.hpp>
+#include <file_stream.hpp>
+#include <helix_cursor.hpp>
+#include <huge_page_resource.hpp>
+#include <readahead_stream.hpp>
+#include "mutation_simulator.hpp"
+#include "object_store.hpp"
+#include "procedural_stream.hpp"
+#include "temporary_file.hpp"
+
+// The building blocks of a comparison, each over a range of sequence lengths
+
+namespace
+{
+
+constexpr std::uint64_t GENOME_SEED = 1;
+
+// Bytes of ordinary (mostly non-telomere) data, generated outside the timed loop
+std::vector<std::byte> packed_bases(std::size_t bases)
+{
+	procedural_stream helix(GENOME_SEED, 0, bases, 0);
+	std::vector<std::byte> bytes(bases / dna::packed_size::value);
+	helix.read_at(0, bytes);
+	return bytes;
+}
+
+// A person whose chromosome 0 is about the given # of bases
+procedural_person person_of_size(std::size_t bases, std::uint64_t person_seed)
+{
+	const double scale = static_cast<double>(bases) / static_cast<double>(procedural::CHROMOSOME_LENGTHS[0]);
+	return procedural_person(GENOME_SEED, person_seed, procedural_person::sex::x, scale);
+}
+
+// Throws away everything written to it, a buffer at a time
+class null_buffer : public std::streambuf
+{
+	char buffer_[1 << 12];
+
+public:
+	null_buffer()
+	{
+		setp(buffer_, buffer_ + sizeof(buffer_));
+	}
+
+protected:
+	int_type overflow(int_type c) override
+	{
+		setp(buffer_, buffer_ + sizeof(buffer_));
+		return traits_type::not_eof(c);
+	}
+};
+
+}
+
+static void BM_unpack(benchmark::State& state)
+{
+	const auto bases = static_cast<std::size_t>(state.range(0));
+	const auto bytes = packed_bases(bases);
+	const dna::sequence_buffer<fake_stream::byte_view> seq(fake_stream::byte_view(bytes.data(), bytes.size()));
+	std::vector<dna::base> out;
+
+	const auto allocations = bench::allocations();
+	bench::perf_counters::instance().start();
+	for (auto _ : state)
+	{
+		out.clear();
+		dna::unpack_into(seq, out);
+		benchmark::DoNotOptimize(out.data());
+	}
+	bench::report(state, bases, allocations, bench::perf_counters::instance().stop());
+}
+BENCHMARK(BM_unpack)->Apply(bench::chromosome_sizes);
+
+static void BM_sequence_buffer_iterate(benchmark::State& state)
+{
+	const auto bases = static_cast<std::size_t>(state.range(0));
+	const auto bytes = packed_bases(bases);
+	const dna::sequence_buffer<fake_stream::byte_view> seq(fake_stream::byte_view(bytes.data(), bytes.size()));
+
+	const auto allocations = bench::allocations();
+	bench::perf_counters::instance().start();
+	for (auto _ : state)
+	{
+		std::size_t sum = 0;
+		for (auto b : seq)
+			sum += static_cast<std::size_t>(b);
+		benchmark::DoNotOptimize(sum);
+	}
+	bench::report(state, bases, allocations, bench::perf_counters::instance().stop());
+}
+BENCHMARK(BM_sequence_buffer_iterate)->Apply(bench::chromosome_sizes);
+
+static void BM_sequence_buffer_print(benchmark::State& state)
+{
+	const auto bases = static_cast<std::size_t>(state.range(0));
+	const auto bytes = packed_bases(bases);
+	const dna::sequence_buffer<fake_stream::byte_view> seq(fake_stream::byte_view(bytes.data(), bytes.size()));
+	null_buffer buffer;
+	std::ostream os(&buffer);
+
+	const auto allocations = bench::allocations();
+	bench::perf_counters::instance().start();
+	for (auto _ : state)
+		os << seq;
+	bench::report(state, bases, allocations, bench::perf_counters::instance().stop());
+}
+BENCHMARK(BM_sequence_buffer_print)->Apply(bench::chromosome_sizes);
+
+static void BM_getDataRange(benchmark::State& state)
+{
+	const auto person = person_of_size(static_cast<std::size_t>(state.range(0)), 1);
+	auto helix = person.chromosome(0);
+
+	const auto allocations = bench::allocations();
+	bench::perf_counters::instance().start();
+	for (auto _ : state)
+		benchmark::DoNotOptimize(dna::Comparator::getDataRange(helix));
+	bench::report(state, static_cast<std::size_t>(helix.size()) * dna::packed_size::value, allocations, bench::perf_counters::instance().stop());
+}
+BENCHMARK(BM_getDataRange)->Apply(bench::chromosome_sizes);
+
+static void BM_getSex(benchmark::State& state)
+{
+	const auto person = person_of_size(static_cast<std::size_t>(state.range(0)), 1);
+	const auto helix = person.chromosome(22);
+
+	const auto allocations = bench::allocations();
+	bench::perf_counters::instance().start();
+	for (auto _ : state)
+		benchmark::DoNotOptimize(dna::Comparator::getSex(helix));
+	bench::report(state, 0, allocations, bench::perf_counters::instance().stop());
+}
+BENCHMARK(BM_getSex)->Apply(bench::chromosome_sizes);
+
+// Chromosome 0 of two people who only differ in their telomeres
+static void BM_compare_identical(benchmark::State& state)
+{
+	const auto a = person_of_size(static_cast<std::size_t>(state.range(0)), 1);
+	const auto b = person_of_size(static_cast<std::size_t>(state.range(0)), 2);
+	std::size_t differences = 0;
+
+	const auto allocations = bench::allocations();
+	bench::perf_counters::instance().start();
+	for (auto _ : state)
+	{
+		auto helix_a = a.chromosome(0);
+		auto helix_b = b.chromosome(0);
+		dna::Comparator::compareChromosome(0, helix_a, helix_b, [&](const dna::Difference&) { ++differences; });
+	}
+	bench::report(state, static_cast<std::size_t>(a.chromosome(0).size()) * dna::packed_size::value, allocations, bench::perf_counters::instance().stop());
+	state.counters["differences"] = benchmark::Counter(static_cast<double>(differences), benchmark::Counter::kAvgIterations);
+}
+BENCHMARK(BM_compare_identical)->Apply(bench::chromosome_sizes);
+
+// Chromosome 0 of a person and a copy of them with the default mix of mutations. The whole
+// genome is mutated, and its ground truth kept in memory, so this stops short of full size.
+static void BM_compare_mutated(benchmark::State& state)
+{
+	const auto a = person_of_size(static_cast<std::size_t>(state.range(0)), 1);
+	const mutated_person b(a, 2);
+	std::vector<dna::Difference> found;
+
+	const auto allocations = bench::allocations();
+	bench::perf_counters::instance().start();
+	for (auto _ : state)
+	{
+		found.clear();
+		auto helix_a = a.chromosome(0);
+		auto helix_b = b.chromosome(0);
+		dna::Comparator::compareChromosome(0, helix_a, helix_b, [&](const dna::Difference& d) { found.push_back(d); });
+	}
+	bench::report(state, static_cast<std::size_t>(a.chromosome(0).size()) * dna::packed_size::value, allocations, bench::perf_counters::instance().stop());
+
+	std::vector<mutation> truth;
+	std::copy_if(b.truth().begin(), b.truth().end(), std::back_inserter(truth), [](const mutation& m) { return m.where.chromosome_idx == 0; });
+	const auto accuracy = score(truth, found);
+	state.counters["recall"] = accuracy.recall();
+	state.counters["precision"] = accuracy.precision();
+}
+BENCHMARK(BM_compare_mutated)->RangeMultiplier(64)->Range(1 << 12, 1 << 24)->Unit(benchmark::kMicrosecond);
+
+// One divergent window of each kind adaptive_policy tells apart, the size the scan hands
+// over. Counters are per window.
+static void BM_align(benchmark::State& state)
+{
+	static constexpr std::array<const char*, 4> KINDS = {"snp", "shift", "banded", "fallback"};
+	constexpr std::size_t window = 1 << 16;
+
+	const auto bytes = packed_bases(2 * window);
+	std::vector<dna::base> a;
+	dna::unpack_into(dna::sequence_buffer<fake_stream::byte_view>(fake_stream::byte_view(bytes.data(), bytes.size())), a);
+	std::vector<dna::base> b(a.begin(), a.begin() + window);
+	auto flip = [](dna::base x) { return static_cast<dna::base>(static_cast<int>(x) ^ 1); };
+
+	const auto kind = static_cast<std::size_t>(state.range(0));
+	switch (kind)
+	{
+	case 0:
+		b[0] = flip(b[0]);
+		break;
+	case 1:
+		b.erase(b.begin(), b.begin() + 8);
+		break;
+	case 2:
+		for (std::size_t i = 0; i < 64; i += 8)
+			b[i] = flip(b[i]);
+		break;
+	default:
+		b.insert(b.begin(), a.begin() + window, a.begin() + window + 1000);
+		break;
+	}
+	a.resize(window);
+	b.resize(window);
+
+	dna::adaptive_policy<> policy;
+	const auto allocations = bench::allocations();
+	bench::perf_counters::instance().start();
+	for (auto _ : state)
+		benchmark::DoNotOptimize(policy.resolve(a, b));
+	bench::report(state, 0, allocations, bench::perf_counters::instance().stop());
+
+	const auto windows = policy.windows();
+	const std::array<std::size_t, 4> handled = {windows.snp, windows.shift, windows.banded, windows.fallback};
+	if (handled[kind] != windows.total())
+		state.SkipWithError("window wasn't handled by the expected aligner");
+	state.SetLabel(KINDS[kind]);
+}
+BENCHMARK(BM_align)->DenseRange(0, 3);
+
+namespace
+{
+
+// A procedural chromosome behind storage that takes a fixed time to answer each read
+class slow_stream
+{
+	procedural_stream helix_;
+	std::chrono::microseconds latency_;
+
+public:
+	slow_stream(procedural_stream helix, std::chrono::microseconds latency) :
+			helix_(std::move(helix)),
+			latency_(latency)
+	{ }
+
+	void seek(long offset)
+	{
+		helix_.seek(offset);
+	}
+
+	long size() const
+	{
+		return helix_.size();
+	}
+
+	auto read()
+	{
+		std::this_thread::sleep_for(latency_);
+		return helix_.read();
+	}
+
+	std::size_t read_at(long offset, std::span<std::byte> out) const
+	{
+		std::this_thread::sleep_for(latency_);
+		return helix_.read_at(offset, out);
+	}
+};
+
+}
+
+// Chromosome 0 of two people who only differ in their telomeres, on storage with 100us
+// reads, read directly (depth 0) or read ahead that many chunks
+static void BM_compare_slow_storage(benchmark::State& state)
+{
+	constexpr std::size_t bases = 1 << 24;
+	constexpr std::chrono::microseconds latency(100);
+	const auto depth = static_cast<std::size_t>(state.range(0));
+	const auto a = person_of_size(bases, 1);
+	const auto b = person_of_size(bases, 2);
+
+	const auto allocations = bench::allocations();
+	for (auto _ : state)
+	{
+		slow_stream helix_a(a.chromosome(0), latency);
+		slow_stream helix_b(b.chromosome(0), latency);
+		if (depth == 0)
+		{
+			dna::Comparator::compareChromosome(0, helix_a, helix_b, [](const dna::Difference&) { });
+		}
+		else
+		{
+			dna::readahead_stream ahead_a(helix_a, depth);
+			dna::readahead_stream ahead_b(helix_b, depth);
+			dna::Comparator::compareChromosome(0, ahead_a, ahead_b, [](const dna::Difference&) { });
+		}
+	}
+	bench::report(state, static_cast<std::size_t>(a.chromosome(0).size()) * dna::packed_size::value, allocations);
+}
+BENCHMARK(BM_compare_slow_storage)->Arg(0)->Arg(1)->Arg(4)->UseRealTime()->Unit(benchmark::kMillisecond);
+
+// Sequentially reading a chromosome file of 1 << 28 bases (from the page cache, once the
+// first iteration has been through it) with io_uring (0) or pread (1)
+static void BM_file_read(benchmark::State& state)
+{
+	constexpr std::size_t bases = 1 << 28;
+	const auto io = state.range(0) == 0 ? dna::file_stream::backend::automatic : dna::file_stream::backend::pread;
+
+	const temporary_file file(packed_bases(bases));
+
+	bool io_uring = false;
+	const auto allocations = bench::allocations();
+	bench::perf_counters::instance().start();
+	for (auto _ : state)
+	{
+		dna::file_stream helix(file.path(), 0, -1, dna::file_stream::DEFAULT_CHUNK_SIZE, dna::file_stream::DEFAULT_DEPTH, io);
+		for (auto seq = helix.read(); seq.size() > 0; seq = helix.read())
+			benchmark::DoNotOptimize(seq.buffer().data());
+		io_uring = helix.uses_io_uring();
+	}
+	bench::report(state, bases, allocations, bench::perf_counters::instance().stop());
+
+	state.SetLabel(io_uring ? "io_uring" : "pread");
+}
+BENCHMARK(BM_file_read)->Arg(0)->Arg(1)->Unit(benchmark::kMillisecond);
+
+// Comparing chromosome 0 of two people stored as objects, with S3-like requests (20ms to
+// first byte, 100MB/s each, 1% short reads) of chunk_size KiB split into parts of 256 KiB,
+// read ahead depth chunks. For tuning chunk size and depth against remote storage.
+static void BM_compare_object_store(benchmark::State& state)
+{
+	constexpr std::size_t bases = 1 << 26;
+	const auto chunk_size = static_cast<std::size_t>(state.range(0)) << 10;
+	const auto depth = static_cast<std::size_t>(state.range(1));
+
+	auto stored = [&](std::uint64_t person_seed) {
+		const auto person = person_of_size(bases, person_seed);
+		const auto helix = person.chromosome(0);
+		std::vector<std::byte> bytes(static_cast<std::size_t>(helix.size()));
+		helix.read_at(0, bytes);
+		return std::make_unique<temporary_file>(bytes);
+	};
+	const auto file_a = stored(1);
+	const auto file_b = stored(2);
+	const auto store_a = std::make_shared<const object_store>(file_a->path());
+	const auto store_b = std::make_shared<const object_store>(file_b->path());
+
+	const auto allocations = bench::allocations();
+	for (auto _ : state)
+	{
+		object_store_stream helix_a(store_a, chunk_size);
+		object_store_stream helix_b(store_b, chunk_size);
+		if (depth == 0)
+		{
+			dna::Comparator::compareChromosome(0, helix_a, helix_b, [](const dna::Difference&) { });
+		}
+		else
+		{
+			dna::readahead_stream ahead_a(helix_a, depth, chunk_size);
+			dna::readahead_stream ahead_b(helix_b, depth, chunk_size);
+			dna::Comparator::compareChromosome(0, ahead_a, ahead_b, [](const dna::Difference&) { });
+		}
+	}
+	bench::report(state, static_cast<std::size_t>(store_a->size()) * dna::packed_size::value, allocations);
+	state.counters["requests"] = benchmark::Counter(static_cast<double>(store_a->stats().requests + store_b->stats().requests), benchmark::Counter::kAvgIterations);
+}
+BENCHMARK(BM_compare_object_store)->ArgsProduct({{256, 1024, 4096}, {0, 2, 8}})->ArgNames({"chunk_kib", "depth"})
+		->Iterations(1)->UseRealTime()->Unit(benchmark::kMillisecond);
+
+namespace
+{
+
+// A procedural chromosome whose read() hands out chunks the caller owns, either freshly
+// allocated or borrowed from a pool
+template<bool Pooled>
+class owning_stream
+{
+	procedural_stream helix_;
+	dna::chunk_pool* pool_;
+	long offset_ = 0;
+
+public:
+	owning_stream(procedural_stream helix, dna::chunk_pool* pool) :
+			helix_(std::move(helix)),
+			pool_(pool)
+	{ }
+
+	void seek(long offset)
+	{
+		offset_ = std::clamp(offset, 0L, size());
+	}
+
+	long size() const
+	{
+		return helix_.size();
+	}
+
+	auto read()
+	{
+		if constexpr (Pooled)
+		{
+			auto chunk = pool_->acquire();
+			chunk.resize(helix_.read_at(offset_, std::span(chunk.data(), chunk.size())));
+			offset_ += static_cast<long>(chunk.size());
+			return dna::pooled_sequence_buffer(std::move(chunk));
+		}
+		else
+		{
+			std::vector<std::byte> chunk(dna::file_stream::DEFAULT_CHUNK_SIZE);
+			chunk.resize(helix_.read_at(offset_, chunk));
+			offset_ += static_cast<long>(chunk.size());
+			return dna::sequence_buffer<std::vector<std::byte>>(std::move(chunk));
+		}
+	}
+};
+
+}
+
+// Streaming a chromosome of 1 << 28 bases through a HelixStream that hands out owning
+// chunks, allocated for every read() (0) or borrowed from a chunk_pool (1)
+static void BM_owning_read(benchmark::State& state)
+{
+	constexpr std::size_t bases = 1 << 28;
+	const auto person = person_of_size(bases, 1);
+	dna::chunk_pool pool(dna::file_stream::DEFAULT_CHUNK_SIZE, 4);
+
+	auto run = [&](auto helix) {
+		for (auto seq = helix.read(); seq.size() > 0; seq = helix.read())
+			benchmark::DoNotOptimize(seq.buffer().data());
+	};
+
+	const auto allocations = bench::allocations();
+	bench::perf_counters::instance().start();
+	for (auto _ : state)
+	{
+		if (state.range(0) == 0)
+			run(owning_stream<false>(person.chromosome(0), &pool));
+		else
+			run(owning_stream<true>(person.chromosome(0), &pool));
+	}
+	bench::report(state, static_cast<std::size_t>(person.chromosome(0).size()) * dna::packed_size::value, allocations,
+			bench::perf_counters::instance().stop());
+	state.SetLabel(state.range(0) == 0 ? "allocated" : "pooled");
+}
+BENCHMARK(BM_owning_read)->Arg(0)->Arg(1)->Unit(benchmark::kMillisecond);
+
+namespace
+{
+
+// kB of this process's memory backed by transparent huge pages
+std::size_t anon_huge_kib()
+{
+	std::ifstream smaps("/proc/self/smaps_rollup");
+	std::string line;
+	while (std::getline(smaps, line))
+	{
+		if (line.starts_with("AnonHugePages:"))
+			return std::stoul(line.substr(std::strlen("AnonHugePages:")));
+	}
+	return 0;
+}
+
+}
+
+// Reads of single bytes at random over a 256 MiB buffer, as an index lookup or a jump to
+// a far away window would do, from ordinary memory (0) or a huge_page_resource (1). Each
+// read is to a different 4 KiB page, so with small pages nearly every one misses the TLB.
+static void BM_random_access(benchmark::State& state)
+{
+	constexpr std::size_t bytes = std::size_t{1} << 28;
+	constexpr std::size_t accesses = 1 << 20;
+
+	dna::huge_page_resource huge;
+	std::pmr::memory_resource* resource = state.range(0) == 0 ? std::pmr::new_delete_resource() : &huge;
+
+	const std::size_t huge_before = anon_huge_kib();
+	auto* memory = static_cast<std::uint8_t*>(resource->allocate(bytes, 64));
+	std::memset(memory, 1, bytes);
+	const std::size_t huge_kib = anon_huge_kib() - std::min(anon_huge_kib(), huge_before);
+
+	std::uint64_t counter = 0;
+	const auto allocations = bench::allocations();
+	bench::perf_counters::instance().start();
+	for (auto _ : state)
+	{
+		std::size_t sum = 0;
+		for (std::size_t i = 0; i < accesses; ++i)
+			sum += memory[procedural::mix(counter++) % bytes];
+		benchmark::DoNotOptimize(sum);
+	}
+	const auto perf = bench::perf_counters::instance().stop();
+	bench::report(state, 0, allocations);
+	resource->deallocate(memory, bytes, 64);
+
+	using benchmark::Counter;
+	state.counters["time_per_access"] = Counter(static_cast<double>(accesses), Counter::kIsIterationInvariantRate | Counter::kInvert);
+	if (const auto misses = perf[bench::perf_counters::dtlb_misses])
+		state.counters["dtlb_misses_per_access"] = *misses / static_cast<double>(state.iterations() * accesses);
+	state.counters["huge_page_mib"] = static_cast<double>(huge_kib) / 1024;
+	state.SetLabel(state.range(0) == 0 ? "new_delete" : "huge_page_resource");
+}
+BENCHMARK(BM_random_access)->Arg(0)->Arg(1)->Unit(benchmark::kMillisecond);
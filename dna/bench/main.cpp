@@ -0,0 +1,60 @@
+#include "bench.hpp"
+
+#include <trace.hpp>
+
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <string_view>
+
+// Google Benchmark's own flags, plus:
+//   --genome_scale=<fraction>  compare a scaled down genome, for quick runs
+//   --genome_threads=<n>       the most threads to compare a genome with
+//   --trace_out=<file>         write Chrome trace JSON of everything run (needs DNA_TRACE)
+int main(int argc, char** argv)
+{
+	bench::genome_options options{};
+	std::string trace_out;
+
+	// Ours are taken out before Google Benchmark sees (and rejects) them
+	int kept = 1;
+	for (int i = 1; i < argc; ++i)
+	{
+		const std::string_view arg = argv[i];
+		if (arg.starts_with("--genome_scale="))
+			options.scale = std::stod(std::string(arg.substr(std::strlen("--genome_scale="))));
+		else if (arg.starts_with("--genome_threads="))
+			options.max_threads = std::stoul(std::string(arg.substr(std::strlen("--genome_threads="))));
+		else if (arg.starts_with("--trace_out="))
+			trace_out = arg.substr(std::strlen("--trace_out="));
+		else
+			argv[kept++] = argv[i];
+	}
+	argc = kept;
+
+	bench::register_genome_benchmarks(options);
+
+	benchmark::Initialize(&argc, argv);
+	if (benchmark::ReportUnrecognizedArguments(argc, argv))
+		return 1;
+
+#ifndef DNA_TRACE
+	if (!trace_out.empty())
+		std::cerr << "dna_bench was built without DNA_TRACE, so the trace will be empty\n";
+#endif
+	dna::trace::recorder::instance().enable(!trace_out.empty());
+
+	if (const auto& counters = bench::perf_counters::instance(); !counters.error().empty())
+		std::cerr << "Running without some performance counters (" << counters.error() << ")\n";
+
+	benchmark::RunSpecifiedBenchmarks();
+	benchmark::Shutdown();
+
+	if (!trace_out.empty())
+	{
+		std::ofstream out(trace_out);
+		dna::trace::recorder::instance().write_chrome_json(out);
+	}
+	return 0;
+}
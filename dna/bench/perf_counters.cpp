@@ -0,0 +1,123 @@
+#include "perf_counters.hpp"
+
+#include <cerrno>
+#include <cstring>
+#include <vector>
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+namespace
+{
+
+struct event_config
+{
+	std::uint32_t type;
+	std::uint64_t config;
+};
+
+constexpr std::array<event_config, bench::perf_counters::COUNT> EVENTS = {{
+	{PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES},
+	{PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS},
+	{PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES},
+	{PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES},
+	{PERF_TYPE_HW_CACHE, PERF_COUNT_HW_CACHE_DTLB | (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16)},
+	{PERF_TYPE_SOFTWARE, PERF_COUNT_SW_PAGE_FAULTS},
+}};
+
+int open_event(const event_config& event, int group_fd)
+{
+	perf_event_attr attr;
+	std::memset(&attr, 0, sizeof(attr));
+	attr.size = sizeof(attr);
+	attr.type = event.type;
+	attr.config = event.config;
+	attr.disabled = group_fd < 0 ? 1 : 0;
+	attr.exclude_kernel = 1;
+	attr.exclude_hv = 1;
+	attr.read_format = PERF_FORMAT_GROUP | PERF_FORMAT_ID | PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+
+	return static_cast<int>(syscall(SYS_perf_event_open, &attr, 0, -1, group_fd, 0));
+}
+
+}
+
+bench::perf_counters::perf_counters() :
+		leader_(-1)
+{
+	fds_.fill(-1);
+
+	for (std::size_t i = 0; i < COUNT; ++i)
+	{
+		fds_[i] = open_event(EVENTS[i], leader_);
+		if (fds_[i] < 0)
+		{
+			if (!error_.empty())
+				error_ += ", ";
+			error_ += std::string(NAMES[i]) + ": " + std::strerror(errno);
+		}
+		else if (leader_ < 0)
+		{
+			leader_ = fds_[i];
+		}
+	}
+}
+
+bench::perf_counters::~perf_counters()
+{
+	for (int fd : fds_)
+		if (fd >= 0)
+			close(fd);
+}
+
+bench::perf_counters& bench::perf_counters::instance()
+{
+	static perf_counters counters;
+	return counters;
+}
+
+void bench::perf_counters::start()
+{
+	if (!available())
+		return;
+
+	ioctl(leader_, PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+	ioctl(leader_, PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+}
+
+bench::perf_counters::reading bench::perf_counters::stop()
+{
+	reading result{};
+	if (!available())
+		return result;
+
+	ioctl(leader_, PERF_EVENT_IOC_DISABLE, PERF_IOC_FLAG_GROUP);
+
+	// { nr, time_enabled, time_running, { value, id } * nr }
+	std::vector<std::uint64_t> buffer(3 + 2 * COUNT);
+	if (read(leader_, buffer.data(), buffer.size() * sizeof(std::uint64_t)) < 0)
+		return result;
+
+	const std::uint64_t count = buffer[0];
+	const double enabled = static_cast<double>(buffer[1]);
+	const double running = static_cast<double>(buffer[2]);
+	const double scale = running > 0 ? enabled / running : 0;
+
+	// Values come back tagged with ids rather than in the order the counters were opened
+	std::array<std::uint64_t, COUNT> ids{};
+	for (std::size_t i = 0; i < COUNT; ++i)
+		if (fds_[i] >= 0)
+			ioctl(fds_[i], PERF_EVENT_IOC_ID, &ids[i]);
+
+	for (std::uint64_t n = 0; n < count; ++n)
+	{
+		const std::uint64_t value = buffer[3 + 2 * n];
+		const std::uint64_t id = buffer[4 + 2 * n];
+		for (std::size_t i = 0; i < COUNT; ++i)
+			if (fds_[i] >= 0 && ids[i] == id)
+				result.values[i] = static_cast<double>(value) * scale;
+	}
+
+	return result;
+}
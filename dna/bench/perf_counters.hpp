@@ -0,0 +1,91 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <string>
+
+// Hardware (and a few software) event counters for the calling thread, read with
+// perf_event_open around a region of code. The counters are opened as one group, so they
+// are all counting at the same time and can be compared with each other.
+//
+// Counters the kernel won't provide (no PMU in a VM, perf_event_paranoid, seccomp, ...)
+// are left out and read as nothing, so benchmarks still run without them.
+
+namespace bench
+{
+
+class perf_counters
+{
+public:
+	enum counter : std::size_t
+	{
+		cycles,
+		instructions,
+		cache_misses,
+		branch_misses,
+		dtlb_misses,
+		page_faults,
+		COUNT,
+	};
+
+	static constexpr std::array<const char*, COUNT> NAMES = {
+		"cycles", "instructions", "cache_misses", "branch_misses", "dtlb_misses", "page_faults",
+	};
+
+	// Counts between start() and stop(), scaled up if the kernel had to multiplex them
+	struct reading
+	{
+		std::array<std::optional<double>, COUNT> values{};
+
+		std::optional<double> operator[](counter c) const noexcept
+		{
+			return values[c];
+		}
+
+		std::optional<double> ipc() const noexcept
+		{
+			if (!values[cycles] || !values[instructions] || *values[cycles] == 0)
+				return std::nullopt;
+			return *values[instructions] / *values[cycles];
+		}
+	};
+
+private:
+	std::array<int, COUNT> fds_;
+	int leader_;
+	std::string error_;
+
+	perf_counters();
+
+public:
+	~perf_counters();
+
+	perf_counters(const perf_counters&) = delete;
+	perf_counters& operator=(const perf_counters&) = delete;
+
+	// Counters for the main thread, which runs the benchmarks, opened on first use
+	static perf_counters& instance();
+
+	bool available() const noexcept
+	{
+		return leader_ >= 0;
+	}
+
+	bool available(counter c) const noexcept
+	{
+		return fds_[c] >= 0;
+	}
+
+	// Why counters are missing, if any are
+	const std::string& error() const noexcept
+	{
+		return error_;
+	}
+
+	void start();
+	reading stop();
+};
+
+}
@@ -0,0 +1,238 @@
+#pragma once
+
+#include "sequence_buffer.hpp"
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <memory_resource>
+#include <stdexcept>
+
+namespace dna
+{
+
+class chunk_pool;
+
+// A chunk borrowed from a chunk_pool, handed back when it is destroyed. It is a ByteBuffer
+// of its first size() bytes, so a sequence_buffer<pooled_chunk> (pooled_sequence_buffer)
+// owns its bytes without them ever having been allocated: a stream can hand out chunks
+// that outlive the next read(), and reading them still doesn't touch malloc.
+//
+// An empty pooled_chunk (the pool had none left) converts to false.
+class pooled_chunk
+{
+	chunk_pool* pool_;
+	std::byte* data_;
+	std::uint32_t index_;
+	std::size_t size_;
+
+	friend class chunk_pool;
+
+	// Leaves this empty, once the chunk has a new owner (or has been handed back)
+	void clear() noexcept
+	{
+		pool_ = nullptr;
+		data_ = nullptr;
+		size_ = 0;
+	}
+
+	pooled_chunk(chunk_pool* pool, std::byte* data, std::uint32_t index, std::size_t size) noexcept :
+			pool_(pool),
+			data_(data),
+			index_(index),
+			size_(size)
+	{ }
+
+public:
+	pooled_chunk() noexcept :
+			pooled_chunk(nullptr, nullptr, 0, 0)
+	{ }
+
+	pooled_chunk(pooled_chunk&& other) noexcept :
+			pooled_chunk(other.pool_, other.data_, other.index_, other.size_)
+	{
+		other.clear();
+	}
+
+	pooled_chunk& operator=(pooled_chunk&& other) noexcept
+	{
+		if (this != &other)
+		{
+			reset();
+			pool_ = other.pool_;
+			data_ = other.data_;
+			index_ = other.index_;
+			size_ = other.size_;
+			other.clear();
+		}
+		return *this;
+	}
+
+	~pooled_chunk()
+	{
+		reset();
+	}
+
+	// Hands the chunk back early
+	inline void reset() noexcept;
+
+	explicit operator bool() const noexcept
+	{
+		return pool_ != nullptr;
+	}
+
+	std::byte* data() noexcept
+	{
+		return data_;
+	}
+
+	const std::byte* data() const noexcept
+	{
+		return data_;
+	}
+
+	// The bytes in use, which start out as the whole chunk
+	std::size_t size() const noexcept
+	{
+		return size_;
+	}
+
+	inline std::size_t capacity() const noexcept;
+
+	// Shrinks (or grows back) the bytes in use, up to capacity()
+	void resize(std::size_t size)
+	{
+		if (size > capacity())
+			throw std::invalid_argument("pooled chunk can't grow past its capacity");
+		size_ = size;
+	}
+
+	std::byte operator[](std::size_t index) const noexcept
+	{
+		return data_[index];
+	}
+};
+
+using pooled_sequence_buffer = sequence_buffer<pooled_chunk>;
+
+// A fixed number of equal chunks carved out of one allocation, each starting on its own
+// cache line, so threads filling neighbouring chunks never share a line. The free list is
+// a lock-free (Treiber) stack of chunk indexes, its head tagged with a counter so that a
+// chunk popped and pushed back in between can't be mistaken for the one first seen.
+//
+// The chunks come from a memory resource, e.g. a huge_page_resource for a large pool. The
+// pool must outlive every chunk borrowed from it.
+class chunk_pool
+{
+public:
+	static constexpr std::size_t CACHE_LINE = 64;
+
+private:
+	static constexpr std::uint32_t NONE = UINT32_MAX;
+
+	std::size_t chunk_size_;
+	std::size_t count_;
+	std::pmr::memory_resource* resource_;
+	std::byte* memory_;
+	std::unique_ptr<std::atomic<std::uint32_t>[]> next_;
+
+	// (tag << 32) | index of the first free chunk
+	alignas(CACHE_LINE) std::atomic<std::uint64_t> head_;
+	alignas(CACHE_LINE) std::atomic<std::size_t> available_;
+
+	static std::uint64_t tagged(std::uint64_t previous, std::uint32_t index) noexcept
+	{
+		return (((previous >> 32) + 1) << 32) | index;
+	}
+
+	friend class pooled_chunk;
+
+	void release(std::uint32_t index) noexcept
+	{
+		auto head = head_.load(std::memory_order_relaxed);
+		do
+		{
+			next_[index].store(static_cast<std::uint32_t>(head), std::memory_order_relaxed);
+		} while (!head_.compare_exchange_weak(head, tagged(head, index), std::memory_order_release, std::memory_order_relaxed));
+
+		available_.fetch_add(1, std::memory_order_relaxed);
+	}
+
+public:
+	// count chunks of at least chunk_size bytes, rounded up to whole cache lines
+	chunk_pool(std::size_t chunk_size, std::size_t count, std::pmr::memory_resource* resource = std::pmr::new_delete_resource()) :
+			chunk_size_((chunk_size + CACHE_LINE - 1) / CACHE_LINE * CACHE_LINE),
+			count_(count),
+			resource_(resource),
+			memory_(nullptr),
+			next_(std::make_unique<std::atomic<std::uint32_t>[]>(count)),
+			head_(count == 0 ? NONE : 0),
+			available_(count)
+	{
+		if (chunk_size == 0 || count >= NONE)
+			throw std::invalid_argument("chunk pool needs chunks of at least 1 byte, and fewer than 2^32 of them");
+
+		memory_ = static_cast<std::byte*>(resource_->allocate(chunk_size_ * count_, CACHE_LINE));
+		for (std::size_t i = 0; i < count_; ++i)
+			next_[i].store(i + 1 < count_ ? static_cast<std::uint32_t>(i + 1) : NONE, std::memory_order_relaxed);
+	}
+
+	chunk_pool(const chunk_pool&) = delete;
+	chunk_pool& operator=(const chunk_pool&) = delete;
+
+	~chunk_pool()
+	{
+		resource_->deallocate(memory_, chunk_size_ * count_, CACHE_LINE);
+	}
+
+	// A free chunk, or an empty one if every chunk is in use. Safe to call from any thread.
+	pooled_chunk acquire() noexcept
+	{
+		auto head = head_.load(std::memory_order_acquire);
+		while (true)
+		{
+			const auto index = static_cast<std::uint32_t>(head);
+			if (index == NONE)
+				return {};
+
+			const auto next = next_[index].load(std::memory_order_relaxed);
+			if (head_.compare_exchange_weak(head, tagged(head, next), std::memory_order_acquire, std::memory_order_acquire))
+			{
+				available_.fetch_sub(1, std::memory_order_relaxed);
+				return {this, memory_ + index * chunk_size_, index, chunk_size_};
+			}
+		}
+	}
+
+	std::size_t chunk_size() const noexcept
+	{
+		return chunk_size_;
+	}
+
+	std::size_t count() const noexcept
+	{
+		return count_;
+	}
+
+	// Chunks not borrowed right now; only a snapshot while other threads are using the pool
+	std::size_t available() const noexcept
+	{
+		return available_.load(std::memory_order_relaxed);
+	}
+};
+
+void pooled_chunk::reset() noexcept
+{
+	if (pool_ != nullptr)
+	{
+		pool_->release(index_);
+		clear();
+	}
+}
+
+std::size_t pooled_chunk::capacity() const noexcept
+{
+	return pool_ == nullptr ? 0 : pool_->chunk_size();
+}
+
+}
@@ -1,36 +1,266 @@
 #pragma once
 
+#include "alignment_policy.hpp"
+#include "difference.hpp"
+#include "helix_cursor.hpp"
 #include "person.hpp"
-
+#include "scratch_arena.hpp"
+#include "trace.hpp"
+
+#include <chrono>
+#include <concepts>
+#include <limits>
+#include <memory_resource>
+#include <optional>
+#include <stdexcept>
+#include <stop_token>
+#include <type_traits>
 #include <vector>
 #include <utility>
 
 namespace dna
 {
-	struct Difference
+	enum class StopReason
 	{
-		// [start, end) index of interesting segment
-		using subsection = std::pair<size_t, size_t>;
+		Completed,
+		MaxDifferences,
+		Deadline,
+		Cancelled,
+	};
 
-		Difference(size_t chromosome_idx, size_t person_a_start, size_t person_a_end, size_t person_b_start, size_t person_b_end) : chromosome_idx{chromosome_idx}, person_a{person_a_start, person_a_end}, person_b{person_b_start, person_b_end}
-		{}
+	// Limits on how much work a comparison may do. The deadline and cancellation are only
+	// checked once per scanned chunk, so they are cheap to honour but not instantaneous.
+	struct CompareOptions
+	{
+		// Report at most this many Differences, stopping with MaxDifferences as soon as
+		// another one is found. A comparison with exactly this many still completes.
+		size_t max_differences = std::numeric_limits<size_t>::max();
+		std::optional<std::chrono::steady_clock::time_point> deadline{};
+		std::stop_token cancellation{};
+
+		// Differences separated by fewer than merge_gap identical bases (in both samples)
+		// are merged into a single region
+		size_t merge_gap = 0;
+		// Regions shorter than min_length bases in both samples are dropped
+		size_t min_length = 0;
+		// Regions where fewer than min_score bases actually differ are dropped
+		size_t min_score = 0;
+
+		bool filters() const noexcept
+		{
+			return merge_gap > 0 || min_length > 0 || min_score > 0;
+		}
+
+		std::optional<StopReason> interrupted() const
+		{
+			if (cancellation.stop_requested())
+			{
+				return StopReason::Cancelled;
+			}
+			if (deadline && std::chrono::steady_clock::now() >= *deadline)
+			{
+				return StopReason::Deadline;
+			}
+			return std::nullopt;
+		}
+	};
+
+	// How far a comparison got. When it stopped early, everything before the given
+	// positions (base indices) of chromosome_idx has been compared. A comparison that
+	// completed reports chromosome_idx as the number of chromosomes.
+	struct ComparisonStatus
+	{
+		StopReason reason = StopReason::Completed;
+		size_t chromosome_idx = 0;
+		size_t person_a_position = 0;
+		size_t person_b_position = 0;
+		size_t differences = 0;
+
+		bool complete() const noexcept
+		{
+			return reason == StopReason::Completed;
+		}
+	};
+
+	// Bases of telomere at either end of a helix
+	struct TelomereLengths
+	{
+		size_t front = 0;
+		size_t back = 0;
+
+		bool operator==(const TelomereLengths&) const = default;
+	};
+
+	// What a comparison did, for capacity planning and for spotting inputs that send it down
+	// slow paths. Each ComparisonContext counts for itself, so nothing is shared between
+	// threads; the stats of several are combined with +=.
+	struct ComparisonStats
+	{
+		struct Telomeres
+		{
+			TelomereLengths person_a;
+			TelomereLengths person_b;
 
-		size_t chromosome_idx;
-		subsection person_a;
-		subsection person_b;
+			bool operator==(const Telomeres&) const = default;
+		};
+
+		size_t chromosomes = 0;
+		// Bases of person a between the telomeres that were scanned, and how many of those the
+		// lockstep scan found to be identical
+		size_t bases_scanned = 0;
+		size_t identical_bases = 0;
+		// read() calls on both people's helices, including for finding the telomeres
+		size_t reads = 0;
+		size_t bytes_read = 0;
+		// Divergent windows handed to the alignment policy, and how it resolved them (if it's
+		// a CountingPolicy)
+		size_t windows = 0;
+		window_counts aligned{};
+		// Indexed by chromosome, empty for chromosomes that weren't compared
+		std::vector<std::optional<Telomeres>> telomeres{};
+
+		double identicalFraction() const noexcept
+		{
+			return bases_scanned == 0 ? 1.0 : static_cast<double>(identical_bases) / static_cast<double>(bases_scanned);
+		}
+
+		void recordTelomeres(size_t chromosome_idx, Telomeres lengths)
+		{
+			if (telomeres.size() <= chromosome_idx)
+			{
+				telomeres.resize(chromosome_idx + 1);
+			}
+			telomeres[chromosome_idx] = lengths;
+		}
+
+		ComparisonStats& operator+=(const ComparisonStats& other)
+		{
+			chromosomes += other.chromosomes;
+			bases_scanned += other.bases_scanned;
+			identical_bases += other.identical_bases;
+			reads += other.reads;
+			bytes_read += other.bytes_read;
+			windows += other.windows;
+			aligned += other.aligned;
+			for (size_t i = 0; i < other.telomeres.size(); ++i)
+			{
+				if (other.telomeres[i])
+				{
+					recordTelomeres(i, *other.telomeres[i]);
+				}
+			}
+			return *this;
+		}
 	};
 
-	template <typename STREAM>
-	STREAM& operator<<(STREAM& os, const Difference& d)
+	struct ComparisonResult
 	{
-		os << "Chromosome " << d.chromosome_idx;
-		os << " | first sample: [" << d.person_a.first << ", " << d.person_a.second << "]";
-		os << " second sample: [" << d.person_b.first << ", " << d.person_b.second << "]";
-		return os;
-	}
+		std::vector<Difference> differences;
+		ComparisonStatus status;
+		ComparisonStats stats;
+	};
+
+	// Sits between the scan and the sink, merging nearby Differences and dropping the
+	// uninteresting ones as they are found, so they never take up any memory downstream
+	template <DifferenceSink Sink>
+	class DifferenceCoalescer
+	{
+		Sink& sink_;
+		const CompareOptions& options_;
+		std::optional<Difference> pending_;
+		size_t pending_score_ = 0;
+
+	public:
+		DifferenceCoalescer(Sink& sink, const CompareOptions& options) : sink_{sink}, options_{options}
+		{}
+
+		// Returns the # of Differences passed on to the sink
+		size_t push(const Difference& d)
+		{
+			if (!options_.filters())
+			{
+				sink_(d);
+				return 1;
+			}
+
+			const size_t score = std::max(d.person_a.second - d.person_a.first, d.person_b.second - d.person_b.first);
+			if (merges(d))
+			{
+				pending_->person_a.second = d.person_a.second;
+				pending_->person_b.second = d.person_b.second;
+				pending_->makeComplex();
+				pending_score_ += score;
+				return 0;
+			}
+
+			const size_t emitted = flush();
+			pending_ = d;
+			pending_score_ = score;
+			return emitted;
+		}
+
+		// Passes on the region being built up, if it is interesting enough
+		size_t flush()
+		{
+			if (!pending_)
+			{
+				return 0;
+			}
+
+			const Difference d = *pending_;
+			const bool emit = flushes();
+			pending_.reset();
+
+			if (!emit)
+			{
+				return 0;
+			}
+
+			sink_(d);
+			return 1;
+		}
+
+		// Whether d would be merged into the region being built up
+		bool merges(const Difference& d) const noexcept
+		{
+			return pending_ && pending_->chromosome_idx == d.chromosome_idx &&
+					d.person_a.first < pending_->person_a.second + options_.merge_gap &&
+					d.person_b.first < pending_->person_b.second + options_.merge_gap;
+		}
+
+		// Whether push(d) would pass anything on to the sink
+		bool emits(const Difference& d) const noexcept
+		{
+			return !options_.filters() || (!merges(d) && flushes());
+		}
+
+		// Whether flush() would pass on the region being built up
+		bool flushes() const noexcept
+		{
+			if (!pending_)
+			{
+				return false;
+			}
+
+			const size_t length = std::max(pending_->person_a.second - pending_->person_a.first, pending_->person_b.second - pending_->person_b.first);
+			return length >= options_.min_length && pending_score_ >= options_.min_score;
+		}
+
+		// The region that may still grow, which hasn't been passed on yet
+		const std::optional<Difference>& pending() const noexcept
+		{
+			return pending_;
+		}
+	};
+
+	template <typename Policy = adaptive_policy<>>
+	class ComparisonContext;
 
 	class Comparator
 	{
+		template <typename>
+		friend class ComparisonContext;
+
 	private:
 		// # of chromosomes in a valid sample
 		static constexpr size_t NUM_CHROMOSOMES = 23;
@@ -42,6 +272,13 @@ namespace dna
 
 		// Fixed sequence of repeating bases in telomeres
 		static constexpr std::array<base, 6> TELOMERE_SEQ = {T, T, A, G, G, G};
+		// Initial # of bases read at a time when scanning backwards for telomeres
+		static constexpr size_t TELOMERE_SCAN_BLOCK = 4096;
+
+		// # of bases compared in lockstep before checking for more data
+		static constexpr size_t SCAN_CHUNK = 1 << 14;
+		// Max # of bases either side of a divergence that an aligner gets to look at
+		static constexpr size_t MAX_WINDOW = 1 << 16;
 
 	public:
 		enum class SexChromosome
@@ -71,47 +308,33 @@ namespace dna
 			return SexChromosome::MAX;
 		}
 
-		// Returns [start, end) of the interesting data in a HelixStream
-		// i.e. the data between telomeres
-		// Returned values are indices of *bases*, NOT bytes
+		// Returns the index of the first base after the telomeres at the front of a HelixStream.
+		// Only the telomeres themselves are read, so this is cheap even for huge helices.
 		template <HelixStream H>
-		static std::pair<size_t, size_t> getDataRange(H& helix)
+		static size_t getDataStart(H& helix, std::pmr::memory_resource* scratch = std::pmr::get_default_resource())
 		{
-			size_t telomere_idx = 0;
-
-			size_t data_start = 0;
-			size_t data_end = helix.size() * packed_size::value;
+			const size_t data_end = helix.size() * packed_size::value;
 
-			// We need to find at least one complete telomere in order to classify it,
-			// so if the helix is too short, we return early
+			// We need to find at least one complete telomere in order to classify it
 			if (data_end < TELOMERE_SEQ.size())
 			{
-				return {data_start, data_end};
+				return 0;
 			}
 
-			// How this function works:
-			// 1. Identify partial telomere if present at beginning of data
-			// 2. Adavance through data until it stops matching telomere pattern
-			// 3. Repeat steps 1 and 2 in reverse for the end of the data
+			size_t telomere_idx = 0;
+			size_t data_start = 0;
 
-			helix.seek(0);
-			auto buffer = helix.read();
-			// XXX TODO
-			// This function as written depends on the buffer being large enough to
-			// hold the entire chromosome. This would clearly not be the case in real-world usage.
-			// Adapting this code to handle streaming reads going forward is relatively simple,
-			// but seeking backwards would be tougher. Perhaps a different approach altogether
-			// would be better, but I've spent enough time on this already that I've decided to
-			// submit what I've got so far.
+			helix_cursor<H> cursor(helix, 0, data_end, scratch);
+			auto head = cursor.peek(TELOMERE_SEQ.size());
 
 			// For each possible starting position in the telomere sequence
 			for (size_t t_idx = 0; t_idx < TELOMERE_SEQ.size(); t_idx++)
 			{
 				bool match = true;
 				// Check each letter in the buffer against the corresponding position in the telomere sequence
-				for (size_t b_idx = 0; b_idx < TELOMERE_SEQ.size() && b_idx < buffer.size(); b_idx++)
+				for (size_t b_idx = 0; b_idx < TELOMERE_SEQ.size(); b_idx++)
 				{
-					if (buffer[b_idx] != TELOMERE_SEQ[(t_idx + b_idx) % TELOMERE_SEQ.size()])
+					if (head[b_idx] != TELOMERE_SEQ[(t_idx + b_idx) % TELOMERE_SEQ.size()])
 					{
 						match = false;
 						break;
@@ -127,25 +350,64 @@ namespace dna
 			}
 
 			// Keep iterating through the data until it stops matching telomeres
-			while (data_start < data_end && buffer[data_start] == TELOMERE_SEQ[telomere_idx])
+			cursor.advance(data_start);
+			while (data_start < data_end && cursor.peek(1)[0] == TELOMERE_SEQ[telomere_idx])
 			{
+				cursor.advance(1);
 				data_start++;
 				telomere_idx = (telomere_idx + 1) % TELOMERE_SEQ.size();
 			}
 
+			return data_start;
+		}
+
+		// Returns [start, end) of the interesting data in a HelixStream
+		// i.e. the data between telomeres
+		// Returned values are indices of *bases*, NOT bytes
+		// Temporary buffers are allocated from scratch.
+		template <HelixStream H>
+		static std::pair<size_t, size_t> getDataRange(H& helix, std::pmr::memory_resource* scratch = std::pmr::get_default_resource())
+		{
+			size_t telomere_idx = 0;
+
+			size_t data_end = helix.size() * packed_size::value;
+
+			// How this function works:
+			// 1. Identify partial telomere if present at beginning of data
+			// 2. Adavance through data until it stops matching telomere pattern
+			// 3. Repeat steps 1 and 2 in reverse for the end of the data
+			size_t data_start = getDataStart(helix, scratch);
+
 			// If there isn't enough room for a complete telomere at the end
 			if (data_end < data_start + TELOMERE_SEQ.size())
 			{
 				return {data_start, data_end};
 			}
 
+			// The end is scanned backwards, so it's read a block at a time (each block
+			// twice the size of the last) and prepended to what has been read so far
+			std::pmr::vector<base> tail(scratch);
+			std::pmr::vector<base> block(scratch);
+			size_t tail_start = data_end;
+			auto tail_at = [&](size_t idx) {
+				if (idx < tail_start)
+				{
+					const size_t block_len = std::max(TELOMERE_SCAN_BLOCK, data_end - tail_start);
+					const size_t block_start = std::min(idx, tail_start - std::min(block_len, tail_start - data_start));
+					read_bases(helix, block_start, tail_start, block, scratch);
+					tail.insert(tail.begin(), block.begin(), block.end());
+					tail_start = block_start;
+				}
+				return tail[idx - tail_start];
+			};
+
 			// Find the end of telomeres the same way as at the front, but backwards
 			for (size_t t_idx = 0; t_idx < TELOMERE_SEQ.size(); t_idx++)
 			{
 				bool match = true;
 				for (size_t b_idx = 0; b_idx < TELOMERE_SEQ.size(); b_idx++)
 				{
-					if (buffer[data_end - 1 - b_idx] != TELOMERE_SEQ[(TELOMERE_SEQ.size() + t_idx - b_idx) % TELOMERE_SEQ.size()])
+					if (tail_at(data_end - 1 - b_idx) != TELOMERE_SEQ[(TELOMERE_SEQ.size() + t_idx - b_idx) % TELOMERE_SEQ.size()])
 					{
 						match = false;
 						break;
@@ -161,7 +423,7 @@ namespace dna
 			}
 
 			// Keep iterating through the data until it stops matching telomeres
-			while (data_end > data_start && buffer[data_end - 1] == TELOMERE_SEQ[telomere_idx])
+			while (data_end > data_start && tail_at(data_end - 1) == TELOMERE_SEQ[telomere_idx])
 			{
 				data_end--;
 				telomere_idx = (TELOMERE_SEQ.size() + telomere_idx - 1) % TELOMERE_SEQ.size();
@@ -172,47 +434,323 @@ namespace dna
 
 		Comparator() = delete; // Static methods only, no instances should be constructed
 
-		template <Person P>
-		static std::vector<Difference> compare(const P& a, const P& b)
+		// Compares the data between the telomeres of two helices, emitting a Difference
+		// for every region where they diverge. This is the unit of work for distributing a
+		// comparison: every chromosome can be compared independently.
+		template <HelixStream HA, HelixStream HB, DifferenceSink Sink, AlignmentPolicy Policy = adaptive_policy<>>
+		static ComparisonStatus compareChromosome(size_t chromosome_idx, HA& helix_a, HB& helix_b, Sink&& sink,
+				const CompareOptions& options = {}, Policy&& policy = Policy{})
 		{
-			if (a.chromosomes() != NUM_CHROMOSOMES || b.chromosomes() != NUM_CHROMOSOMES)
+			ComparisonContext<Policy&> context(policy);
+			return context.compareChromosome(chromosome_idx, helix_a, helix_b, sink, options);
+		}
+
+		// Compares whatever is left of two cursors (helix_cursor, span_cursor or anything else
+		// with the same interface) the same way as compareChromosome. A cursor that isn't
+		// done() has to peek() at least one base. What the scan did is added to stats, if given.
+		template <typename CursorA, typename CursorB, DifferenceSink Sink, AlignmentPolicy Policy = adaptive_policy<>>
+		static ComparisonStatus compareRange(size_t chromosome_idx, CursorA& cursor_a, CursorB& cursor_b, Sink&& sink,
+				const CompareOptions& options = {}, Policy&& policy = Policy{}, ComparisonStats* stats = nullptr)
+		{
+			DNA_TRACE_SCOPE("scan", chromosome_idx);
+			ComparisonStatus status{};
+			status.chromosome_idx = chromosome_idx;
+
+			DifferenceCoalescer out(sink, options);
+
+			// Counted locally and only added to stats at the end
+			const size_t scan_start = cursor_a.position();
+			size_t identical = 0;
+			size_t windows = 0;
+			window_counts aligned_before{};
+			if constexpr (CountingPolicy<std::remove_reference_t<Policy>>)
+			{
+				aligned_before = policy.windows();
+			}
+
+			// Everything before the stopping point has been passed on to the sink, so a region
+			// that was still being merged is left for whoever resumes from there
+			auto stop = [&](StopReason reason) {
+				if (stats)
+				{
+					stats->bases_scanned += cursor_a.position() - scan_start;
+					stats->identical_bases += identical;
+					stats->windows += windows;
+					if constexpr (CountingPolicy<std::remove_reference_t<Policy>>)
+					{
+						window_counts aligned = policy.windows();
+						aligned -= aligned_before;
+						stats->aligned += aligned;
+					}
+				}
+
+				status.reason = reason;
+				status.person_a_position = out.pending() ? out.pending()->person_a.first : cursor_a.position();
+				status.person_b_position = out.pending() ? out.pending()->person_b.first : cursor_b.position();
+				return status;
+			};
+
+			// Deadline and cancellation are polled once every SCAN_CHUNK bases
+			size_t next_check = cursor_a.position();
+
+			while (!cursor_a.done() && !cursor_b.done())
+			{
+				if (cursor_a.position() >= next_check)
+				{
+					if (auto reason = options.interrupted())
+					{
+						return stop(*reason);
+					}
+					next_check = cursor_a.position() + SCAN_CHUNK;
+				}
+
+				// Skip past everything the two have in common
+				auto chunk_a = cursor_a.peek(SCAN_CHUNK);
+				auto chunk_b = cursor_b.peek(SCAN_CHUNK);
+				auto same = mismatch_offset(chunk_a, chunk_b);
+
+				cursor_a.advance(same);
+				cursor_b.advance(same);
+				identical += same;
+				if (same == std::min(chunk_a.size(), chunk_b.size()))
+				{
+					continue;
+				}
+
+				// Then let the policy work out how far the divergence extends
+				auto window_a = cursor_a.peek(MAX_WINDOW);
+				auto window_b = cursor_b.peek(MAX_WINDOW);
+				++windows;
+				auto [a_len, b_len] = [&] {
+					DNA_TRACE_SCOPE("align", chromosome_idx);
+					return policy.resolve(window_a, window_b);
+				}();
+
+				// The scan only moves on if the policy resolved something, see AlignmentPolicy
+				a_len = std::min(a_len, window_a.size());
+				b_len = std::min(b_len, window_b.size());
+				if (a_len == 0 && b_len == 0)
+				{
+					a_len = std::min<size_t>(1, window_a.size());
+					b_len = std::min<size_t>(1, window_b.size());
+				}
+
+				Difference d(chromosome_idx,
+						cursor_a.position(), cursor_a.position() + a_len,
+						cursor_b.position(), cursor_b.position() + b_len);
+				d.setEdit(window_a.first(a_len), window_b.first(b_len));
+
+				// Only a Difference that actually reaches the sink past the budget means there are
+				// more than max_differences, so only then is the scan cut short; finding exactly
+				// that many (or more that get merged or dropped) still completes
+				if (status.differences >= options.max_differences && out.emits(d))
+				{
+					return stop(StopReason::MaxDifferences);
+				}
+				status.differences += out.push(d);
+
+				cursor_a.advance(a_len);
+				cursor_b.advance(b_len);
+			}
+
+			// Whatever is left over in only one of the two has nothing to compare against
+			if (!cursor_a.done() || !cursor_b.done())
+			{
+				const Difference rest(chromosome_idx,
+						cursor_a.position(), cursor_a.end(),
+						cursor_b.position(), cursor_b.end());
+				if (status.differences >= options.max_differences && out.emits(rest))
+				{
+					return stop(StopReason::MaxDifferences);
+				}
+				status.differences += out.push(rest);
+
+				cursor_a.advance(cursor_a.remaining());
+				cursor_b.advance(cursor_b.remaining());
+			}
+
+			// Everything was scanned, so only a region still being merged can go over budget
+			if (status.differences >= options.max_differences && out.flushes())
+			{
+				return stop(StopReason::MaxDifferences);
+			}
+
+			status.differences += out.flush();
+			return stop(StopReason::Completed);
+		}
+
+		// Streams every Difference between two people into sink as soon as it is found,
+		// so nothing needs to be buffered for the whole genome. Callers comparing many pairs
+		// should keep a ComparisonContext instead, which stays warm between comparisons.
+		// The people needn't be the same type, e.g. one read from disk and one simulated.
+		template <Person PA, Person PB, DifferenceSink Sink, AlignmentPolicy Policy = adaptive_policy<>>
+		static ComparisonStatus compare(const PA& a, const PB& b, Sink&& sink, const CompareOptions& options = {}, Policy&& policy = Policy{})
+		{
+			ComparisonContext<Policy&> context(policy);
+			return context.compare(a, b, sink, options);
+		}
+
+		template <Person PA, Person PB, AlignmentPolicy Policy = adaptive_policy<>>
+		static ComparisonResult compare(const PA& a, const PB& b, const CompareOptions& options, Policy&& policy = Policy{})
+		{
+			ComparisonContext<Policy&> context(policy);
+			return context.compare(a, b, options);
+		}
+
+		template <Person PA, Person PB, AlignmentPolicy Policy = adaptive_policy<>>
+		static std::vector<Difference> compare(const PA& a, const PB& b, Policy&& policy = Policy{})
+		{
+			return compare(a, b, CompareOptions{}, policy).differences;
+		}
+	};
+	// Owns everything a comparison needs besides the people being compared: the alignment
+	// policy (along with its aligners' buffers) and a scratch arena that read buffers are
+	// allocated from. The arena is reset before every chromosome and keeps its memory, so a
+	// worker that keeps one context for all of its comparisons stops allocating once the
+	// first few are done. Policy may be a reference, to borrow a policy owned elsewhere.
+	//
+	// A context is not thread-safe; every thread needs its own.
+	template <typename Policy>
+	class ComparisonContext
+	{
+		static_assert(AlignmentPolicy<std::remove_reference_t<Policy>>, "Policy must be an AlignmentPolicy");
+
+		Policy policy_;
+		scratch_arena scratch_;
+		ComparisonStats stats_;
+
+	public:
+		ComparisonContext() = default;
+
+		explicit ComparisonContext(Policy policy) : policy_(std::forward<Policy>(policy))
+		{}
+
+		std::remove_reference_t<Policy>& policy() noexcept
+		{
+			return policy_;
+		}
+
+		const scratch_arena& scratch() const noexcept
+		{
+			return scratch_;
+		}
+
+		// Everything compared with this context since it was made or last reset
+		const ComparisonStats& stats() const noexcept
+		{
+			return stats_;
+		}
+
+		void resetStats()
+		{
+			stats_ = {};
+		}
+
+		// See Comparator::compareChromosome
+		template <HelixStream HA, HelixStream HB, DifferenceSink Sink>
+		ComparisonStatus compareChromosome(size_t chromosome_idx, HA& helix_a, HB& helix_b, Sink&& sink, const CompareOptions& options = {})
+		{
+			DNA_TRACE_SCOPE("chromosome", chromosome_idx);
+
+			// Nothing allocated for the previous chromosome is still alive
+			scratch_.reset();
+
+			counting_stream counted_a(helix_a);
+			counting_stream counted_b(helix_b);
+
+			auto [a_start, a_end] = [&] {
+				DNA_TRACE_SCOPE("telomeres", chromosome_idx);
+				return Comparator::getDataRange(counted_a, &scratch_);
+			}();
+			auto [b_start, b_end] = [&] {
+				DNA_TRACE_SCOPE("telomeres", chromosome_idx);
+				return Comparator::getDataRange(counted_b, &scratch_);
+			}();
+
+			ComparisonStatus status{};
+			{
+				helix_cursor cursor_a(counted_a, a_start, a_end, &scratch_);
+				helix_cursor cursor_b(counted_b, b_start, b_end, &scratch_);
+				status = Comparator::compareRange(chromosome_idx, cursor_a, cursor_b, sink, options, policy_, &stats_);
+			}
+
+			const size_t a_length = static_cast<size_t>(helix_a.size()) * packed_size::value;
+			const size_t b_length = static_cast<size_t>(helix_b.size()) * packed_size::value;
+			stats_.chromosomes++;
+			stats_.reads += counted_a.reads() + counted_b.reads();
+			stats_.bytes_read += counted_a.bytes_read() + counted_b.bytes_read();
+			stats_.recordTelomeres(chromosome_idx, {{a_start, a_length - a_end}, {b_start, b_length - b_end}});
+
+			return status;
+		}
+
+		// See Comparator::compare
+		template <Person PA, Person PB, DifferenceSink Sink>
+		ComparisonStatus compare(const PA& a, const PB& b, Sink&& sink, const CompareOptions& options = {})
+		{
+			DNA_TRACE_SCOPE("compare");
+			if (a.chromosomes() != Comparator::NUM_CHROMOSOMES || b.chromosomes() != Comparator::NUM_CHROMOSOMES)
 			{
 				throw std::invalid_argument("chromosome data does not match expected size");
 			}
 
-			std::vector<Difference> ret{};
+			// Each chromosome only gets whatever is left of the difference budget
+			CompareOptions remaining = options;
 
-			for (size_t chromosome_idx = 0; chromosome_idx < NUM_CHROMOSOMES; chromosome_idx++)
+			for (size_t chromosome_idx = 0; chromosome_idx < Comparator::NUM_CHROMOSOMES; chromosome_idx++)
 			{
 				auto helix_a = a.chromosome(chromosome_idx);
 				auto helix_b = b.chromosome(chromosome_idx);
 
-				if (chromosome_idx == SEX_CHROMOSOME_IDX)
+				if (chromosome_idx == Comparator::SEX_CHROMOSOME_IDX)
 				{
-					auto a_sex = getSex(helix_a);
-					auto b_sex = getSex(helix_b);
+					auto a_sex = Comparator::getSex(helix_a);
+					auto b_sex = Comparator::getSex(helix_b);
 
 					// We don't want to compare sex chromosomes if sexes are different
-					if ((a_sex != b_sex) || (a_sex == SexChromosome::MAX))
+					if ((a_sex != b_sex) || (a_sex == Comparator::SexChromosome::MAX))
 					{
 						continue;
 					}
 				}
 
-				auto [a_start, a_end] = getDataRange(helix_a);
-				auto [b_start, b_end] = getDataRange(helix_b);
+				// With 99.9% of the genome being the same between people, almost everything is
+				// skipped by comparing in lockstep; only divergent windows are handed to the
+				// alignment policy
+				auto status = compareChromosome(chromosome_idx, helix_a, helix_b, sink, remaining);
+				remaining.max_differences -= status.differences;
 
-				// XXX TODO: the general idea from here is to seek each stream to the start of the
-				// interesting (non-telomere data) and compare chunks. With 99.9% of the genome
-				// being the same between people, hopefully many chunks will be base-for-base
-				// identical and not require any additional processing. Of the chunks that do,
-				// I would look at something like this:
-				// https://en.wikipedia.org/wiki/Needleman%E2%80%93Wunsch_algorithm
-				// to try to find large sequences that don't align well and report those
-				// as meaningful differences between people.
+				if (!status.complete())
+				{
+					status.differences = options.max_differences - remaining.max_differences;
+					return status;
+				}
 			}
 
+			ComparisonStatus status{};
+			status.chromosome_idx = Comparator::NUM_CHROMOSOMES;
+			status.differences = options.max_differences - remaining.max_differences;
+			return status;
+		}
+
+		// The stats are for this comparison alone, but are still added to the context's
+		template <Person PA, Person PB>
+		ComparisonResult compare(const PA& a, const PB& b, const CompareOptions& options)
+		{
+			ComparisonStats total = std::exchange(stats_, {});
+
+			ComparisonResult ret{};
+			ret.status = compare(a, b, [&ret](const Difference& d) { ret.differences.push_back(d); }, options);
+			ret.stats = stats_;
+
+			stats_ = std::move(total += ret.stats);
 			return ret;
 		}
+
+		template <Person PA, Person PB>
+		std::vector<Difference> compare(const PA& a, const PB& b)
+		{
+			return compare(a, b, CompareOptions{}).differences;
+		}
 	};
 }
@@ -0,0 +1,136 @@
+#pragma once
+
+#include "base.hpp"
+
+#include <concepts>
+#include <cstdint>
+#include <utility>
+
+namespace dna
+{
+	enum class DifferenceKind : std::uint8_t
+	{
+		Snp,       // one base substituted for another
+		Insertion, // bases present only in person b
+		Deletion,  // bases present only in person a
+		Complex,   // anything else, including merged regions
+	};
+
+	constexpr const char* to_string(DifferenceKind kind)
+	{
+		switch (kind)
+		{
+			case DifferenceKind::Snp:
+				return "SNP";
+			case DifferenceKind::Insertion:
+				return "insertion";
+			case DifferenceKind::Deletion:
+				return "deletion";
+			default:
+				return "complex";
+		}
+	}
+
+	struct Difference
+	{
+		// [start, end) index of interesting segment
+		using subsection = std::pair<size_t, size_t>;
+
+		// Small events carry the bases involved: person a's bases followed by person b's
+		static constexpr size_t MAX_EDIT_BASES = 32;
+
+		Difference(size_t chromosome_idx, size_t person_a_start, size_t person_a_end, size_t person_b_start, size_t person_b_end) : chromosome_idx{chromosome_idx}, person_a{person_a_start, person_a_end}, person_b{person_b_start, person_b_end}, kind{classify(person_a_end - person_a_start, person_b_end - person_b_start)}
+		{}
+
+		size_t chromosome_idx;
+		subsection person_a;
+		subsection person_b;
+		DifferenceKind kind;
+		// # of bases packed into edit, 0 if the event was too large (or merged) to record
+		std::uint8_t edit_length = 0;
+		// 2 bits per base, first base in the lowest bits
+		std::uint64_t edit = 0;
+
+		size_t a_length() const noexcept
+		{
+			return person_a.second - person_a.first;
+		}
+
+		size_t b_length() const noexcept
+		{
+			return person_b.second - person_b.first;
+		}
+
+		bool hasEdit() const noexcept
+		{
+			return edit_length > 0;
+		}
+
+		// The idx'th base of the recorded edit
+		base editBase(size_t idx) const noexcept
+		{
+			return static_cast<base>((edit >> (2 * idx)) & 0x3);
+		}
+
+		// Records the bases of a small event, given the bases from each person's region
+		void setEdit(base_span a, base_span b) noexcept
+		{
+			if (a.size() + b.size() > MAX_EDIT_BASES)
+			{
+				return;
+			}
+
+			edit = 0;
+			size_t idx = 0;
+			for (auto span : {a, b})
+			{
+				for (auto v : span)
+				{
+					edit |= static_cast<std::uint64_t>(v) << (2 * idx++);
+				}
+			}
+			edit_length = static_cast<std::uint8_t>(idx);
+		}
+
+		// Forgets the kind and bases, e.g. after merging with another region
+		void makeComplex() noexcept
+		{
+			kind = DifferenceKind::Complex;
+			edit_length = 0;
+			edit = 0;
+		}
+
+		bool operator==(const Difference&) const = default;
+
+		static constexpr DifferenceKind classify(size_t a_length, size_t b_length) noexcept
+		{
+			if (a_length == 1 && b_length == 1)
+			{
+				return DifferenceKind::Snp;
+			}
+			if (a_length == 0)
+			{
+				return DifferenceKind::Insertion;
+			}
+			if (b_length == 0)
+			{
+				return DifferenceKind::Deletion;
+			}
+			return DifferenceKind::Complex;
+		}
+	};
+
+	// Receives Differences as soon as they are found, in order of position within each chromosome
+	template <typename T>
+	concept DifferenceSink = std::invocable<T&, const Difference&>;
+
+	template <typename STREAM>
+	STREAM& operator<<(STREAM& os, const Difference& d)
+	{
+		os << "Chromosome " << d.chromosome_idx;
+		os << " | first sample: [" << d.person_a.first << ", " << d.person_a.second << "]";
+		os << " second sample: [" << d.person_b.first << ", " << d.person_b.second << "]";
+		os << " " << to_string(d.kind);
+		return os;
+	}
+}
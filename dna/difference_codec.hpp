@@ -0,0 +1,255 @@
+#pragma once
+
+#include "difference.hpp"
+
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace dna
+{
+	namespace detail
+	{
+		inline void putVarint(std::vector<std::byte>& out, std::uint64_t value)
+		{
+			while (value >= 0x80)
+			{
+				out.push_back(static_cast<std::byte>(value | 0x80));
+				value >>= 7;
+			}
+			out.push_back(static_cast<std::byte>(value));
+		}
+
+		inline std::uint64_t zigzag(std::int64_t value) noexcept
+		{
+			return (static_cast<std::uint64_t>(value) << 1) ^ static_cast<std::uint64_t>(value >> 63);
+		}
+
+		inline std::int64_t unzigzag(std::uint64_t value) noexcept
+		{
+			return static_cast<std::int64_t>(value >> 1) ^ -static_cast<std::int64_t>(value & 1);
+		}
+
+		// Tag byte layout, see DifferenceEncoder
+		static constexpr std::uint8_t TAG_KIND_MASK = 0x03;
+		static constexpr std::uint8_t TAG_HAS_EDIT = 0x04;
+		static constexpr std::uint8_t TAG_NEW_CHROMOSOME = 0x08;
+		static constexpr unsigned TAG_SNP_EDIT_SHIFT = 4;
+
+		class ByteReader
+		{
+			std::span<const std::byte> data_;
+			size_t offset_ = 0;
+
+		public:
+			explicit ByteReader(std::span<const std::byte> data) : data_{data}
+			{}
+
+			bool done() const noexcept
+			{
+				return offset_ >= data_.size();
+			}
+
+			std::uint8_t byte()
+			{
+				if (done())
+				{
+					throw std::invalid_argument("truncated difference encoding");
+				}
+				return std::to_integer<std::uint8_t>(data_[offset_++]);
+			}
+
+			std::uint64_t varint()
+			{
+				std::uint64_t value = 0;
+				for (unsigned shift = 0; shift < 64; shift += 7)
+				{
+					auto b = byte();
+					value |= static_cast<std::uint64_t>(b & 0x7F) << shift;
+					if ((b & 0x80) == 0)
+					{
+						return value;
+					}
+				}
+				throw std::invalid_argument("malformed varint in difference encoding");
+			}
+		};
+	}
+
+	// Compact binary encoding of a stream of Differences, for shipping them between jobs.
+	//
+	// Records are grouped per chromosome; the first record of a group carries the chromosome
+	// index. Person a's start is delta-coded against the end of the previous record in the
+	// group, and person b's start as the change in its offset from person a's, which is
+	// almost always zero. Both are zigzag varints. Lengths implied by the kind aren't stored
+	// (a SNP is one base in each), and a SNP's two bases fit in its tag byte, so a typical
+	// SNP takes three or four bytes.
+	//
+	// Tag byte: bits 0-1 kind | bit 2 edit present | bit 3 new chromosome | bits 4-7 SNP bases
+	class DifferenceEncoder
+	{
+		std::vector<std::byte>& out_;
+		bool started_ = false;
+		size_t chromosome_idx_ = 0;
+		size_t prev_a_end_ = 0;
+		size_t prev_b_end_ = 0;
+
+	public:
+		// Appends to out
+		explicit DifferenceEncoder(std::vector<std::byte>& out) : out_{out}
+		{}
+
+		void operator()(const Difference& d)
+		{
+			// Only trust a kind whose lengths can be recovered from it
+			auto kind = d.kind;
+			if (kind != DifferenceKind::Complex && kind != Difference::classify(d.a_length(), d.b_length()))
+			{
+				kind = DifferenceKind::Complex;
+			}
+
+			auto tag = static_cast<std::uint8_t>(kind);
+			if (d.hasEdit())
+			{
+				tag |= detail::TAG_HAS_EDIT;
+				if (kind == DifferenceKind::Snp)
+				{
+					tag |= static_cast<std::uint8_t>(d.edit << detail::TAG_SNP_EDIT_SHIFT);
+				}
+			}
+
+			const bool new_group = !started_ || d.chromosome_idx != chromosome_idx_;
+			if (new_group)
+			{
+				tag |= detail::TAG_NEW_CHROMOSOME;
+				started_ = true;
+				chromosome_idx_ = d.chromosome_idx;
+				prev_a_end_ = 0;
+				prev_b_end_ = 0;
+			}
+
+			out_.push_back(static_cast<std::byte>(tag));
+			if (new_group)
+			{
+				detail::putVarint(out_, d.chromosome_idx);
+			}
+
+			detail::putVarint(out_, detail::zigzag(static_cast<std::int64_t>(d.person_a.first - prev_a_end_)));
+			detail::putVarint(out_, detail::zigzag(static_cast<std::int64_t>((d.person_b.first - d.person_a.first) - (prev_b_end_ - prev_a_end_))));
+
+			if (kind == DifferenceKind::Deletion || kind == DifferenceKind::Complex)
+			{
+				detail::putVarint(out_, d.a_length());
+			}
+			if (kind == DifferenceKind::Insertion || kind == DifferenceKind::Complex)
+			{
+				detail::putVarint(out_, d.b_length());
+			}
+
+			if (d.hasEdit() && kind != DifferenceKind::Snp)
+			{
+				for (size_t i = 0; i < d.edit_length; i += packed_size::value)
+				{
+					out_.push_back(static_cast<std::byte>(d.edit >> (2 * i)));
+				}
+			}
+
+			prev_a_end_ = d.person_a.second;
+			prev_b_end_ = d.person_b.second;
+		}
+	};
+
+	// Decodes everything produced by a DifferenceEncoder into sink.
+	// Throws std::invalid_argument if the data is truncated or malformed.
+	template <DifferenceSink Sink>
+	void decodeDifferences(std::span<const std::byte> data, Sink&& sink)
+	{
+		detail::ByteReader reader(data);
+		bool started = false;
+		size_t chromosome_idx = 0;
+		size_t prev_a_end = 0;
+		size_t prev_b_end = 0;
+
+		while (!reader.done())
+		{
+			const auto tag = reader.byte();
+			const auto kind = static_cast<DifferenceKind>(tag & detail::TAG_KIND_MASK);
+
+			if (tag & detail::TAG_NEW_CHROMOSOME)
+			{
+				started = true;
+				chromosome_idx = reader.varint();
+				prev_a_end = 0;
+				prev_b_end = 0;
+			}
+			else if (!started)
+			{
+				throw std::invalid_argument("difference encoding doesn't start with a chromosome");
+			}
+
+			const size_t a_start = prev_a_end + static_cast<size_t>(detail::unzigzag(reader.varint()));
+			const size_t b_start = a_start + (prev_b_end - prev_a_end) + static_cast<size_t>(detail::unzigzag(reader.varint()));
+
+			size_t a_len = (kind == DifferenceKind::Snp) ? 1 : 0;
+			size_t b_len = a_len;
+			if (kind == DifferenceKind::Deletion || kind == DifferenceKind::Complex)
+			{
+				a_len = reader.varint();
+			}
+			if (kind == DifferenceKind::Insertion || kind == DifferenceKind::Complex)
+			{
+				b_len = reader.varint();
+			}
+			if (a_len > SIZE_MAX - a_start || b_len > SIZE_MAX - b_start)
+			{
+				throw std::invalid_argument("difference runs past the end of the address space");
+			}
+
+			Difference d(chromosome_idx, a_start, a_start + a_len, b_start, b_start + b_len);
+			d.kind = kind;
+
+			if (tag & detail::TAG_HAS_EDIT)
+			{
+				if (a_len + b_len > Difference::MAX_EDIT_BASES)
+				{
+					throw std::invalid_argument("difference edit is longer than " + std::to_string(Difference::MAX_EDIT_BASES) + " bases");
+				}
+				d.edit_length = static_cast<std::uint8_t>(a_len + b_len);
+				if (kind == DifferenceKind::Snp)
+				{
+					d.edit = tag >> detail::TAG_SNP_EDIT_SHIFT;
+				}
+				else
+				{
+					for (size_t i = 0; i < d.edit_length; i += packed_size::value)
+					{
+						d.edit |= static_cast<std::uint64_t>(reader.byte()) << (2 * i);
+					}
+				}
+			}
+
+			sink(d);
+			prev_a_end = d.person_a.second;
+			prev_b_end = d.person_b.second;
+		}
+	}
+
+	inline std::vector<std::byte> encodeDifferences(std::span<const Difference> differences)
+	{
+		std::vector<std::byte> out{};
+		DifferenceEncoder encoder(out);
+		for (const auto& d : differences)
+		{
+			encoder(d);
+		}
+		return out;
+	}
+
+	inline std::vector<Difference> decodeDifferences(std::span<const std::byte> data)
+	{
+		std::vector<Difference> ret{};
+		decodeDifferences(data, [&ret](const Difference& d) { ret.push_back(d); });
+		return ret;
+	}
+}
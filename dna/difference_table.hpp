@@ -0,0 +1,185 @@
+#pragma once
+
+#include "difference.hpp"
+
+#include <cstdint>
+#include <memory_resource>
+#include <span>
+#include <stdexcept>
+#include <vector>
+
+namespace dna
+{
+	enum class Sample
+	{
+		A,
+		B,
+	};
+
+	// Column-oriented (structure-of-arrays) store of Differences for aggregating results
+	// from many comparisons. Queries only touch the columns they need, and every filter is
+	// a straight branch-free pass over those columns that the compiler can vectorize.
+	//
+	// A table is itself a DifferenceSink, so Comparator::compare can write straight into
+	// the columns without materializing Difference structs first. The columns come from the
+	// given memory resource, e.g. a huge_page_resource for a table of a whole cohort.
+	class DifferenceTable
+	{
+		std::pmr::vector<std::uint16_t> chromosome_;
+		std::pmr::vector<std::uint64_t> a_start_;
+		std::pmr::vector<std::uint64_t> a_end_;
+		std::pmr::vector<std::uint64_t> b_start_;
+		std::pmr::vector<std::uint64_t> b_end_;
+		// Empty when the table was built without kinds
+		std::pmr::vector<DifferenceKind> kind_;
+		bool with_kind_;
+
+	public:
+		using Selection = std::vector<std::uint32_t>;
+
+		explicit DifferenceTable(bool with_kind = true, std::pmr::memory_resource* resource = std::pmr::get_default_resource()) :
+				chromosome_{resource},
+				a_start_{resource},
+				a_end_{resource},
+				b_start_{resource},
+				b_end_{resource},
+				kind_{resource},
+				with_kind_{with_kind}
+		{}
+
+		void operator()(const Difference& d)
+		{
+			chromosome_.push_back(static_cast<std::uint16_t>(d.chromosome_idx));
+			a_start_.push_back(d.person_a.first);
+			a_end_.push_back(d.person_a.second);
+			b_start_.push_back(d.person_b.first);
+			b_end_.push_back(d.person_b.second);
+			if (with_kind_)
+			{
+				kind_.push_back(d.kind);
+			}
+		}
+
+		void append(std::span<const Difference> differences)
+		{
+			reserve(size() + differences.size());
+			for (const auto& d : differences)
+			{
+				(*this)(d);
+			}
+		}
+
+		void reserve(size_t rows)
+		{
+			chromosome_.reserve(rows);
+			a_start_.reserve(rows);
+			a_end_.reserve(rows);
+			b_start_.reserve(rows);
+			b_end_.reserve(rows);
+			if (with_kind_)
+			{
+				kind_.reserve(rows);
+			}
+		}
+
+		void clear() noexcept
+		{
+			chromosome_.clear();
+			a_start_.clear();
+			a_end_.clear();
+			b_start_.clear();
+			b_end_.clear();
+			kind_.clear();
+		}
+
+		size_t size() const noexcept
+		{
+			return chromosome_.size();
+		}
+
+		bool hasKind() const noexcept
+		{
+			return with_kind_;
+		}
+
+		std::span<const std::uint16_t> chromosomes() const noexcept
+		{
+			return chromosome_;
+		}
+
+		std::span<const std::uint64_t> starts(Sample sample) const noexcept
+		{
+			return sample == Sample::A ? a_start_ : b_start_;
+		}
+
+		std::span<const std::uint64_t> ends(Sample sample) const noexcept
+		{
+			return sample == Sample::A ? a_end_ : b_end_;
+		}
+
+		std::span<const DifferenceKind> kinds() const noexcept
+		{
+			return kind_;
+		}
+
+		// Rebuilds row idx. Edit bases aren't stored, so none are recorded.
+		Difference row(size_t idx) const
+		{
+			Difference d(chromosome_[idx], a_start_[idx], a_end_[idx], b_start_[idx], b_end_[idx]);
+			if (with_kind_)
+			{
+				d.kind = kind_[idx];
+			}
+			return d;
+		}
+
+		// Rows on chromosome_idx whose region in sample overlaps [start, end).
+		// Insertions (empty regions) count as covering the position they were inserted at.
+		Selection overlapping(size_t chromosome_idx, size_t start, size_t end, Sample sample = Sample::A) const
+		{
+			const auto starts = this->starts(sample);
+			const auto ends = this->ends(sample);
+			const auto chromosome = static_cast<std::uint16_t>(chromosome_idx);
+
+			std::vector<std::uint8_t> mask(size());
+			for (size_t i = 0; i < mask.size(); ++i)
+			{
+				const std::uint64_t effective_end = ends[i] + (ends[i] == starts[i]);
+				mask[i] = static_cast<std::uint8_t>((chromosome_[i] == chromosome) & (starts[i] < end) & (effective_end > start));
+			}
+
+			return select(mask);
+		}
+
+		// Rows of the given kind. Throws std::logic_error if the table has no kinds.
+		Selection ofKind(DifferenceKind kind) const
+		{
+			if (!with_kind_)
+			{
+				throw std::logic_error("difference table was built without kinds");
+			}
+
+			std::vector<std::uint8_t> mask(size());
+			for (size_t i = 0; i < mask.size(); ++i)
+			{
+				mask[i] = static_cast<std::uint8_t>(kind_[i] == kind);
+			}
+
+			return select(mask);
+		}
+
+		// Indices of the rows whose mask byte is non-zero
+		static Selection select(std::span<const std::uint8_t> mask)
+		{
+			Selection ret{};
+			for (size_t i = 0; i < mask.size(); ++i)
+			{
+				if (mask[i])
+				{
+					ret.push_back(static_cast<std::uint32_t>(i));
+				}
+			}
+			return ret;
+		}
+	};
+}
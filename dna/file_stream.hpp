@@ -0,0 +1,581 @@
+#pragma once
+
+#include "sequence_buffer.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <system_error>
+#include <vector>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+#if __has_include(<linux/io_uring.h>)
+#include <linux/io_uring.h>
+#define DNA_HAVE_IO_URING 1
+#endif
+
+// Packed chromosomes read straight from a file (or a byte range of one), as stored on
+// local disk.
+//
+// Sequential reads keep several chunks in flight at once with io_uring, so that the device
+// sees a queue of requests rather than one blocking pread at a time. Each chunk is read
+// into a buffer registered with the ring, and every chunk that can be requested is
+// submitted with a single system call. Where io_uring isn't available (old kernels,
+// seccomp, io_uring_disabled) the same stream falls back to pread.
+//
+// read_at() is a plain pread that doesn't touch the stream's position, so any number of
+// threads can read shards of the same chromosome at once.
+
+namespace dna
+{
+
+namespace detail
+{
+
+inline std::system_error io_error(int error, const char* what)
+{
+	return std::system_error(error, std::generic_category(), what);
+}
+
+// Fills out with the bytes of fd from offset onwards, stopping early only at the end of
+// the file. Returns the # of bytes read.
+inline std::size_t pread_fully(int fd, std::span<std::byte> out, long offset)
+{
+	std::size_t done = 0;
+	while (done < out.size())
+	{
+		const ssize_t n = ::pread(fd, out.data() + done, out.size() - done, offset + static_cast<long>(done));
+		if (n < 0 && errno == EINTR)
+			continue;
+		if (n < 0)
+			throw io_error(errno, "pread failed");
+		if (n == 0)
+			break;
+		done += static_cast<std::size_t>(n);
+	}
+	return done;
+}
+
+#ifdef DNA_HAVE_IO_URING
+
+// The parts of liburing a file_stream needs, on raw system calls: a submission and a
+// completion queue shared with the kernel, and a set of registered buffers to read into
+class io_uring_queue
+{
+	int fd_;
+	void* sq_ring_;
+	std::size_t sq_ring_size_;
+	void* cq_ring_;
+	std::size_t cq_ring_size_;
+	io_uring_sqe* sqes_;
+	std::size_t sqes_size_;
+
+	unsigned* sq_tail_;
+	unsigned* sq_mask_;
+	unsigned* sq_array_;
+	unsigned* cq_head_;
+	unsigned* cq_tail_;
+	unsigned* cq_mask_;
+	io_uring_cqe* cqes_;
+
+	unsigned prepared_; // entries written since the last submit()
+	bool registered_;
+
+	io_uring_queue() :
+			fd_(-1),
+			sq_ring_(MAP_FAILED),
+			sq_ring_size_(0),
+			cq_ring_(MAP_FAILED),
+			cq_ring_size_(0),
+			sqes_(static_cast<io_uring_sqe*>(MAP_FAILED)),
+			sqes_size_(0),
+			prepared_(0),
+			registered_(false)
+	{ }
+
+	template<typename T>
+	static T* at(void* ring, unsigned offset) noexcept
+	{
+		return reinterpret_cast<T*>(static_cast<char*>(ring) + offset);
+	}
+
+public:
+	io_uring_queue(const io_uring_queue&) = delete;
+	io_uring_queue& operator=(const io_uring_queue&) = delete;
+
+	~io_uring_queue()
+	{
+		if (sqes_ != MAP_FAILED)
+			::munmap(sqes_, sqes_size_);
+		if (cq_ring_ != MAP_FAILED && cq_ring_ != sq_ring_)
+			::munmap(cq_ring_, cq_ring_size_);
+		if (sq_ring_ != MAP_FAILED)
+			::munmap(sq_ring_, sq_ring_size_);
+		if (fd_ >= 0)
+			::close(fd_);
+	}
+
+	// A ring with room for entries reads in flight, reading into buffers if the kernel lets
+	// them be registered. Nothing if io_uring can't be used at all.
+	static std::unique_ptr<io_uring_queue> create(unsigned entries, std::span<const iovec> buffers) noexcept
+	{
+		std::unique_ptr<io_uring_queue> q(new io_uring_queue());
+
+		io_uring_params params;
+		std::memset(&params, 0, sizeof(params));
+		q->fd_ = static_cast<int>(::syscall(__NR_io_uring_setup, entries, &params));
+		if (q->fd_ < 0)
+			return nullptr;
+
+		q->sq_ring_size_ = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+		q->cq_ring_size_ = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+		const bool single_mmap = params.features & IORING_FEAT_SINGLE_MMAP;
+		if (single_mmap)
+			q->sq_ring_size_ = q->cq_ring_size_ = std::max(q->sq_ring_size_, q->cq_ring_size_);
+
+		q->sq_ring_ = ::mmap(nullptr, q->sq_ring_size_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, q->fd_, IORING_OFF_SQ_RING);
+		if (q->sq_ring_ == MAP_FAILED)
+			return nullptr;
+		q->cq_ring_ = single_mmap ? q->sq_ring_
+				: ::mmap(nullptr, q->cq_ring_size_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, q->fd_, IORING_OFF_CQ_RING);
+		if (q->cq_ring_ == MAP_FAILED)
+			return nullptr;
+
+		q->sqes_size_ = params.sq_entries * sizeof(io_uring_sqe);
+		q->sqes_ = static_cast<io_uring_sqe*>(::mmap(nullptr, q->sqes_size_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, q->fd_, IORING_OFF_SQES));
+		if (q->sqes_ == MAP_FAILED)
+			return nullptr;
+
+		q->sq_tail_ = at<unsigned>(q->sq_ring_, params.sq_off.tail);
+		q->sq_mask_ = at<unsigned>(q->sq_ring_, params.sq_off.ring_mask);
+		q->sq_array_ = at<unsigned>(q->sq_ring_, params.sq_off.array);
+		q->cq_head_ = at<unsigned>(q->cq_ring_, params.cq_off.head);
+		q->cq_tail_ = at<unsigned>(q->cq_ring_, params.cq_off.tail);
+		q->cq_mask_ = at<unsigned>(q->cq_ring_, params.cq_off.ring_mask);
+		q->cqes_ = at<io_uring_cqe>(q->cq_ring_, params.cq_off.cqes);
+
+		// Registering pins the buffers, which RLIMIT_MEMLOCK may not allow; plain reads
+		// still work without it
+		q->registered_ = ::syscall(__NR_io_uring_register, q->fd_, IORING_REGISTER_BUFFERS, buffers.data(), buffers.size()) == 0;
+
+		return q;
+	}
+
+	bool registered() const noexcept
+	{
+		return registered_;
+	}
+
+	// Queues a read of length bytes at offset into buffer (registered buffer buffer_index),
+	// to be sent by the next submit(). There must be room for it in the ring.
+	void prepare_read(int fd, void* buffer, unsigned buffer_index, unsigned length, long offset, std::uint64_t user_data) noexcept
+	{
+		const unsigned tail = *sq_tail_ + prepared_;
+		const unsigned index = tail & *sq_mask_;
+
+		io_uring_sqe& sqe = sqes_[index];
+		std::memset(&sqe, 0, sizeof(sqe));
+		sqe.opcode = registered_ ? IORING_OP_READ_FIXED : IORING_OP_READ;
+		sqe.fd = fd;
+		sqe.addr = reinterpret_cast<std::uint64_t>(buffer);
+		sqe.len = length;
+		sqe.off = static_cast<std::uint64_t>(offset);
+		sqe.buf_index = static_cast<std::uint16_t>(registered_ ? buffer_index : 0);
+		sqe.user_data = user_data;
+
+		sq_array_[index] = index;
+		++prepared_;
+	}
+
+	// Hands everything prepared to the kernel, in one system call, and waits until at least
+	// wait_for completions are ready
+	void submit(unsigned wait_for)
+	{
+		unsigned to_submit = prepared_;
+		if (to_submit == 0 && wait_for == 0)
+			return;
+
+		std::atomic_ref<unsigned>(*sq_tail_).store(*sq_tail_ + to_submit, std::memory_order_release);
+		prepared_ = 0;
+
+		while (true)
+		{
+			const int n = static_cast<int>(::syscall(__NR_io_uring_enter, fd_, to_submit, wait_for,
+					wait_for > 0 ? IORING_ENTER_GETEVENTS : 0, nullptr, 0));
+			if (n >= 0)
+			{
+				to_submit -= std::min(to_submit, static_cast<unsigned>(n));
+				if (to_submit == 0)
+					return;
+			}
+			else if (errno != EINTR && errno != EAGAIN && errno != EBUSY)
+			{
+				throw io_error(errno, "io_uring_enter failed");
+			}
+		}
+	}
+
+	// Takes the next completion off the queue, if there is one
+	bool pop(std::uint64_t& user_data, int& result) noexcept
+	{
+		const unsigned head = *cq_head_;
+		if (head == std::atomic_ref<unsigned>(*cq_tail_).load(std::memory_order_acquire))
+			return false;
+
+		const io_uring_cqe& cqe = cqes_[head & *cq_mask_];
+		user_data = cqe.user_data;
+		result = cqe.res;
+		std::atomic_ref<unsigned>(*cq_head_).store(head + 1, std::memory_order_release);
+		return true;
+	}
+};
+
+#endif
+
+}
+
+class file_stream
+{
+public:
+	enum class backend
+	{
+		// io_uring if the kernel allows it, otherwise pread
+		automatic,
+		pread,
+	};
+
+	static constexpr std::size_t DEFAULT_CHUNK_SIZE = 1 << 16;
+	static constexpr std::size_t DEFAULT_DEPTH = 8;
+
+private:
+	struct file
+	{
+		int fd;
+
+		~file()
+		{
+			::close(fd);
+		}
+	};
+
+	struct chunk
+	{
+		std::size_t bytes = 0;
+		int error = 0; // errno of a read that failed
+		bool done = false;
+	};
+
+	std::shared_ptr<const file> file_;
+	long begin_; // of the chromosome in the file
+	long size_;
+	std::size_t chunk_size_;
+	std::size_t depth_;
+	backend backend_;
+	long position_;
+
+	// Sequential reading state, set up by the first read(). Chunk k after base_ is read
+	// into buffer k % depth_.
+	std::vector<std::byte> buffers_;
+	std::vector<chunk> chunks_;
+#ifdef DNA_HAVE_IO_URING
+	std::unique_ptr<detail::io_uring_queue> ring_;
+#endif
+	bool set_up_;
+	long base_;             // position of chunk 0
+	std::uint64_t requested_;
+	std::uint64_t consumed_;
+	std::uint64_t in_flight_;
+
+	std::byte* buffer(std::uint64_t k) noexcept
+	{
+		return buffers_.data() + (k % depth_) * chunk_size_;
+	}
+
+	long chunk_offset(std::uint64_t k) const noexcept
+	{
+		return base_ + static_cast<long>(k * chunk_size_);
+	}
+
+	std::size_t chunk_length(std::uint64_t k) const noexcept
+	{
+		return static_cast<std::size_t>(std::clamp<long>(size_ - chunk_offset(k), 0, static_cast<long>(chunk_size_)));
+	}
+
+	void set_up()
+	{
+		set_up_ = true;
+		buffers_.resize(depth_ * chunk_size_);
+		chunks_.resize(depth_);
+
+#ifdef DNA_HAVE_IO_URING
+		if (backend_ == backend::automatic)
+		{
+			std::vector<iovec> iovecs(depth_);
+			for (std::size_t i = 0; i < depth_; ++i)
+				iovecs[i] = iovec{buffer(i), chunk_size_};
+			ring_ = detail::io_uring_queue::create(static_cast<unsigned>(depth_), iovecs);
+		}
+#endif
+	}
+
+#ifdef DNA_HAVE_IO_URING
+	// Submits whatever is prepared and takes every completion ready once at least wait_for
+	// are. Unless keep, the completions are only counted. A read that failed marks its
+	// chunk with the error, for read() to throw when it gets to it, so the queue is always
+	// emptied of whatever completed.
+	void reap(unsigned wait_for, bool keep = true)
+	{
+		ring_->submit(wait_for);
+
+		std::uint64_t k;
+		int result;
+		while (ring_->pop(k, result))
+		{
+			--in_flight_;
+			if (!keep)
+				continue;
+
+			auto& c = chunks_[k % depth_];
+			c.done = true;
+			if (result < 0)
+			{
+				c.error = -result;
+				continue;
+			}
+
+			// Short reads are finished off synchronously
+			c.bytes = static_cast<std::size_t>(result);
+			const std::size_t length = chunk_length(k);
+			try
+			{
+				if (c.bytes < length && c.bytes > 0)
+					c.bytes += detail::pread_fully(file_->fd, std::span(buffer(k) + c.bytes, length - c.bytes), begin_ + chunk_offset(k) + static_cast<long>(c.bytes));
+			}
+			catch (const std::system_error& e)
+			{
+				c.error = e.code().value();
+			}
+		}
+	}
+#endif
+
+	// Waits for everything in flight, so the buffers can be reused or freed
+	void drain() noexcept
+	{
+#ifdef DNA_HAVE_IO_URING
+		while (ring_ && in_flight_ > 0)
+		{
+			try
+			{
+				reap(1, false);
+			}
+			catch (...)
+			{ }
+		}
+#endif
+	}
+
+	// Starts sequential reading over from position_, with nothing in flight
+	void restart() noexcept
+	{
+		drain();
+		base_ = position_;
+		requested_ = consumed_ = 0;
+	}
+
+public:
+	// Reads the whole file, or length bytes from offset of it. Throws std::system_error if
+	// it can't be opened, std::invalid_argument if the range isn't inside it.
+	explicit file_stream(const std::string& path, long offset = 0, long length = -1, std::size_t chunk_size = DEFAULT_CHUNK_SIZE,
+			std::size_t depth = DEFAULT_DEPTH, backend io = backend::automatic) :
+			begin_(offset),
+			size_(length),
+			chunk_size_(chunk_size),
+			depth_(depth),
+			backend_(io),
+			position_(0),
+			set_up_(false),
+			base_(0),
+			requested_(0),
+			consumed_(0),
+			in_flight_(0)
+	{
+		if (chunk_size_ == 0 || depth_ == 0)
+			throw std::invalid_argument("chunk size and depth must be at least 1");
+
+		const int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+		if (fd < 0)
+			throw detail::io_error(errno, ("can't open " + path).c_str());
+		file_ = std::shared_ptr<const file>(new file{fd});
+
+		struct stat st;
+		if (::fstat(fd, &st) != 0)
+			throw detail::io_error(errno, "fstat failed");
+		if (size_ < 0)
+			size_ = static_cast<long>(st.st_size) - begin_;
+		if (begin_ < 0 || size_ < 0 || begin_ + size_ > static_cast<long>(st.st_size))
+			throw std::invalid_argument("range is outside the file");
+	}
+
+	// Copies share the open file and start from the same position, with buffers of their own
+	file_stream(const file_stream& other) :
+			file_(other.file_),
+			begin_(other.begin_),
+			size_(other.size_),
+			chunk_size_(other.chunk_size_),
+			depth_(other.depth_),
+			backend_(other.backend_),
+			position_(other.position_),
+			set_up_(false),
+			base_(0),
+			requested_(0),
+			consumed_(0),
+			in_flight_(0)
+	{ }
+
+	file_stream(file_stream&& other) noexcept = default;
+
+	file_stream& operator=(const file_stream& other)
+	{
+		if (this != &other)
+		{
+			file_stream copy(other);
+			*this = std::move(copy);
+		}
+		return *this;
+	}
+
+	file_stream& operator=(file_stream&& other) noexcept
+	{
+		drain();
+		file_ = std::move(other.file_);
+		begin_ = other.begin_;
+		size_ = other.size_;
+		chunk_size_ = other.chunk_size_;
+		depth_ = other.depth_;
+		backend_ = other.backend_;
+		position_ = other.position_;
+		buffers_ = std::move(other.buffers_);
+		chunks_ = std::move(other.chunks_);
+#ifdef DNA_HAVE_IO_URING
+		ring_ = std::move(other.ring_);
+#endif
+		set_up_ = other.set_up_;
+		base_ = other.base_;
+		requested_ = other.requested_;
+		consumed_ = other.consumed_;
+		in_flight_ = other.in_flight_;
+		other.set_up_ = false;
+		other.in_flight_ = 0;
+		return *this;
+	}
+
+	~file_stream()
+	{
+		drain();
+	}
+
+	// Whether sequential reads go through io_uring; only known after the first read()
+	bool uses_io_uring() const noexcept
+	{
+#ifdef DNA_HAVE_IO_URING
+		return ring_ != nullptr;
+#else
+		return false;
+#endif
+	}
+
+	void seek(long offset)
+	{
+		offset = std::clamp(offset, 0L, size_);
+		if (offset == position_)
+			return;
+
+		position_ = offset;
+		restart();
+	}
+
+	long size() const
+	{
+		return size_;
+	}
+
+	// The next chunk; valid until the next call to read()
+	sequence_buffer<std::span<const std::byte>> read()
+	{
+		if (!set_up_)
+		{
+			set_up();
+			base_ = position_;
+		}
+		if (position_ >= size_)
+			return {std::span<const std::byte>(), 0};
+
+		const std::uint64_t k = consumed_++;
+		auto& c = chunks_[k % depth_];
+
+#ifdef DNA_HAVE_IO_URING
+		if (ring_)
+		{
+			// The buffer handed out last time is free again, so every buffer can be in flight
+			for (; requested_ < consumed_ - 1 + depth_ && chunk_length(requested_) > 0; ++requested_)
+			{
+				chunks_[requested_ % depth_] = chunk{};
+				ring_->prepare_read(file_->fd, buffer(requested_), static_cast<unsigned>(requested_ % depth_),
+						static_cast<unsigned>(chunk_length(requested_)), begin_ + chunk_offset(requested_), requested_);
+				++in_flight_;
+			}
+
+			reap(0);
+			while (!c.done)
+				reap(1);
+
+			// The next read() tries the same bytes again
+			if (c.error != 0)
+			{
+				const int error = c.error;
+				restart();
+				throw detail::io_error(error, "io_uring read failed");
+			}
+		}
+		else
+#endif
+		{
+			try
+			{
+				c.bytes = detail::pread_fully(file_->fd, std::span(buffer(k), chunk_length(k)), begin_ + chunk_offset(k));
+			}
+			catch (...)
+			{
+				restart();
+				throw;
+			}
+		}
+
+		position_ += static_cast<long>(c.bytes);
+		return {std::span<const std::byte>(buffer(k), c.bytes), c.bytes * packed_size::value};
+	}
+
+	// Fills out with the bytes starting at offset, without moving the read position. Returns
+	// the # of bytes written, which is less than out.size() only at the end. Safe to call
+	// from any number of threads at once.
+	std::size_t read_at(long offset, std::span<std::byte> out) const
+	{
+		const long first = std::clamp(offset, 0L, size_);
+		const auto count = std::min(out.size(), static_cast<std::size_t>(size_ - first));
+		return detail::pread_fully(file_->fd, out.first(count), begin_ + first);
+	}
+};
+
+}
@@ -0,0 +1,284 @@
+#pragma once
+
+#include "person.hpp"
+#include "trace.hpp"
+
+#include <algorithm>
+#include <memory_resource>
+#include <vector>
+
+namespace dna
+{
+
+namespace detail
+{
+
+// Every possible packed byte, unpacked into its four bases
+inline constexpr auto UNPACK_TABLE = [] {
+	std::array<packed_bases, 256> table{};
+	for (std::size_t i = 0; i < table.size(); ++i)
+		table[i] = unpack(static_cast<std::byte>(i));
+	return table;
+}();
+
+}
+
+// Appends every base held by a sequence_buffer to out
+template<ByteBuffer T, typename Allocator>
+void unpack_into(const sequence_buffer<T>& seq, std::vector<base, Allocator>& out)
+{
+	const std::size_t offset = out.size();
+	const std::size_t whole_bytes = seq.size() / packed_size::value;
+
+	out.resize(offset + seq.size());
+	base* dst = out.data() + offset;
+
+	for (std::size_t i = 0; i < whole_bytes; ++i, dst += packed_size::value)
+	{
+		const auto& bases = detail::UNPACK_TABLE[std::to_integer<std::size_t>(seq.buffer()[i])];
+		std::copy(bases.begin(), bases.end(), dst);
+	}
+
+	for (std::size_t i = whole_bytes * packed_size::value; i < seq.size(); ++i)
+		*dst++ = seq[i];
+}
+
+// Forward-only view of the bases in [start, end) of a HelixStream.
+// Chunks are read and unpacked on demand, so callers can look an arbitrary
+// distance ahead of the current position before consuming anything.
+// The cursor owns the stream's read position for as long as it is in use.
+// Its buffer comes from the given memory resource, so a caller comparing many helices can
+// hand it scratch memory that is reused from one helix to the next.
+template<HelixStream H>
+class helix_cursor
+{
+	// Consumed bases are only discarded once they make up at least this much of the buffer
+	static constexpr std::size_t COMPACT_THRESHOLD = 1 << 16;
+
+	H& helix_;
+	std::pmr::vector<base> bases_;
+	std::size_t head_;     // index into bases_ of position_
+	std::size_t position_; // base index in the helix
+	std::size_t end_;
+	std::size_t skip_;     // bases to drop from the front of the next read
+	bool drained_;
+
+public:
+	helix_cursor(H& helix, std::size_t start, std::size_t end,
+			std::pmr::memory_resource* resource = std::pmr::get_default_resource()) :
+			helix_(helix),
+			bases_(resource),
+			head_(0),
+			position_(start),
+			end_(end),
+			skip_(0),
+			drained_(false)
+	{
+		seek(start);
+	}
+
+	std::size_t position() const noexcept
+	{
+		return position_;
+	}
+
+	std::size_t end() const noexcept
+	{
+		return end_;
+	}
+
+	std::size_t remaining() const noexcept
+	{
+		return end_ - position_;
+	}
+
+	bool done() const noexcept
+	{
+		return position_ >= end_;
+	}
+
+	// Returns up to count bases starting at the current position. Fewer are returned
+	// only when the end of the range is reached. The span is invalidated by the next
+	// call to peek(), advance() or seek().
+	base_span peek(std::size_t count)
+	{
+		count = std::min(count, remaining());
+		while (buffered() < count && !drained_)
+			fill();
+
+		return base_span(bases_.data() + head_, std::min(count, buffered()));
+	}
+
+	void advance(std::size_t count)
+	{
+		if (count <= buffered())
+		{
+			head_ += count;
+			position_ += count;
+		}
+		else
+		{
+			seek(std::min(position_ + count, end_));
+		}
+	}
+
+	// Repositions the cursor anywhere within [start, end)
+	void seek(std::size_t position)
+	{
+		position_ = std::min(position, end_);
+		bases_.clear();
+		head_ = 0;
+		skip_ = position_ % packed_size::value;
+		drained_ = done();
+		helix_.seek(static_cast<long>(position_ / packed_size::value));
+	}
+
+private:
+	std::size_t buffered() const noexcept
+	{
+		return bases_.size() - head_;
+	}
+
+	void fill()
+	{
+		if (head_ >= COMPACT_THRESHOLD && head_ * 2 >= bases_.size())
+		{
+			bases_.erase(bases_.begin(), bases_.begin() + static_cast<long>(head_));
+			head_ = 0;
+		}
+
+		auto seq = [&] {
+			DNA_TRACE_SCOPE("read");
+			return helix_.read();
+		}();
+		if (seq.size() == 0)
+		{
+			drained_ = true;
+			return;
+		}
+
+		const std::size_t before = bases_.size();
+		unpack_into(seq, bases_);
+
+		if (skip_ > 0)
+		{
+			const std::size_t skipped = std::min(skip_, bases_.size() - before);
+			bases_.erase(bases_.begin() + static_cast<long>(before), bases_.begin() + static_cast<long>(before + skipped));
+			skip_ -= skipped;
+		}
+
+		if (buffered() >= remaining())
+		{
+			bases_.resize(head_ + remaining());
+			drained_ = true;
+		}
+	}
+};
+
+// Passes everything through to a HelixStream, counting the read() calls and the bytes
+// they return
+template<HelixStream H>
+class counting_stream
+{
+	H& helix_;
+	std::size_t reads_;
+	std::size_t bytes_;
+
+public:
+	explicit counting_stream(H& helix) noexcept :
+			helix_(helix),
+			reads_(0),
+			bytes_(0)
+	{ }
+
+	void seek(long offset)
+	{
+		helix_.seek(offset);
+	}
+
+	auto size() const
+	{
+		return helix_.size();
+	}
+
+	auto read()
+	{
+		auto seq = helix_.read();
+		++reads_;
+		bytes_ += (seq.size() + packed_size::value - 1) / packed_size::value;
+		return seq;
+	}
+
+	std::size_t reads() const noexcept
+	{
+		return reads_;
+	}
+
+	std::size_t bytes_read() const noexcept
+	{
+		return bytes_;
+	}
+};
+
+// The same interface as helix_cursor over bases that are already in memory, for
+// comparing against a sequence that was read once up front. Positions start at origin.
+class span_cursor
+{
+	base_span bases_;
+	std::size_t origin_;
+	std::size_t head_;
+
+public:
+	explicit span_cursor(base_span bases, std::size_t origin = 0) :
+			bases_(bases),
+			origin_(origin),
+			head_(0)
+	{ }
+
+	std::size_t position() const noexcept
+	{
+		return origin_ + head_;
+	}
+
+	std::size_t end() const noexcept
+	{
+		return origin_ + bases_.size();
+	}
+
+	std::size_t remaining() const noexcept
+	{
+		return bases_.size() - head_;
+	}
+
+	bool done() const noexcept
+	{
+		return head_ >= bases_.size();
+	}
+
+	base_span peek(std::size_t count) const noexcept
+	{
+		return bases_.subspan(head_, std::min(count, remaining()));
+	}
+
+	void advance(std::size_t count) noexcept
+	{
+		head_ += std::min(count, remaining());
+	}
+
+	void seek(std::size_t position) noexcept
+	{
+		head_ = std::min(position - std::min(position, origin_), bases_.size());
+	}
+};
+
+// Reads the bases in [start, end) of a helix into out, buffering them in scratch on the way
+template<HelixStream H, typename Allocator>
+void read_bases(H& helix, std::size_t start, std::size_t end, std::vector<base, Allocator>& out,
+		std::pmr::memory_resource* scratch = std::pmr::get_default_resource())
+{
+	helix_cursor<H> cursor(helix, start, end, scratch);
+	auto bases = cursor.peek(end - start);
+	out.assign(bases.begin(), bases.end());
+}
+
+}
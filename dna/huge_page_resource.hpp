@@ -0,0 +1,129 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory_resource>
+#include <new>
+#include <sys/mman.h>
+
+namespace dna
+{
+
+// Memory for large buffers (chunk pools, whole chromosomes, k-mer indexes) backed by huge
+// pages where the system allows it, so that walking gigabytes of it doesn't miss the TLB
+// every 4 KiB.
+//
+// Large allocations are mapped whole huge pages at a time: first from the reserved pool
+// (MAP_HUGETLB), which is usually empty unless vm.nr_hugepages was set, then as ordinary
+// memory aligned to a huge page and marked MADV_HUGEPAGE for transparent huge pages. The
+// kernel may still back that with small pages (THP disabled, memory fragmented), which is
+// the clean fallback: the memory works all the same. Allocations smaller than min_bytes
+// aren't worth a mapping of their own and go to the upstream resource.
+class huge_page_resource : public std::pmr::memory_resource
+{
+public:
+	static constexpr std::size_t HUGE_PAGE = std::size_t{2} << 20;
+
+	// How many allocations took each path
+	struct counts
+	{
+		std::atomic<std::size_t> reserved{0};    // MAP_HUGETLB
+		std::atomic<std::size_t> transparent{0}; // madvise(MADV_HUGEPAGE) accepted
+		std::atomic<std::size_t> small_pages{0}; // mapped, but huge pages were refused
+		std::atomic<std::size_t> upstream{0};    // below min_bytes
+	};
+
+private:
+	std::size_t min_bytes_;
+	bool use_reserved_;
+	std::pmr::memory_resource* upstream_;
+	counts counts_;
+
+	static std::size_t round_up(std::size_t bytes) noexcept
+	{
+		return (bytes + HUGE_PAGE - 1) / HUGE_PAGE * HUGE_PAGE;
+	}
+
+	bool mapped(std::size_t bytes, std::size_t alignment) const noexcept
+	{
+		return bytes >= min_bytes_ && alignment <= HUGE_PAGE;
+	}
+
+public:
+	explicit huge_page_resource(std::size_t min_bytes = HUGE_PAGE / 2, bool use_reserved = true,
+			std::pmr::memory_resource* upstream = std::pmr::new_delete_resource()) :
+			min_bytes_(min_bytes),
+			use_reserved_(use_reserved),
+			upstream_(upstream)
+	{ }
+
+	huge_page_resource(const huge_page_resource&) = delete;
+	huge_page_resource& operator=(const huge_page_resource&) = delete;
+
+	const counts& allocations() const noexcept
+	{
+		return counts_;
+	}
+
+protected:
+	void* do_allocate(std::size_t bytes, std::size_t alignment) override
+	{
+		if (!mapped(bytes, alignment))
+		{
+			++counts_.upstream;
+			return upstream_->allocate(bytes, alignment);
+		}
+
+		const std::size_t length = round_up(bytes);
+#ifdef MAP_HUGETLB
+		if (use_reserved_)
+		{
+			void* p = ::mmap(nullptr, length, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+			if (p != MAP_FAILED)
+			{
+				++counts_.reserved;
+				return p;
+			}
+		}
+#endif
+
+		// Over-map by a huge page, then trim either side so the rest starts on a boundary.
+		// A huge page can only back an aligned range.
+		void* p = ::mmap(nullptr, length + HUGE_PAGE, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+		if (p == MAP_FAILED)
+			throw std::bad_alloc();
+
+		const auto raw = reinterpret_cast<std::uintptr_t>(p);
+		const auto aligned = (raw + HUGE_PAGE - 1) / HUGE_PAGE * HUGE_PAGE;
+		if (aligned > raw)
+			::munmap(p, aligned - raw);
+		if (const auto tail = raw + length + HUGE_PAGE - (aligned + length); tail > 0)
+			::munmap(reinterpret_cast<void*>(aligned + length), tail);
+
+#ifdef MADV_HUGEPAGE
+		if (::madvise(reinterpret_cast<void*>(aligned), length, MADV_HUGEPAGE) == 0)
+		{
+			++counts_.transparent;
+			return reinterpret_cast<void*>(aligned);
+		}
+#endif
+		++counts_.small_pages;
+		return reinterpret_cast<void*>(aligned);
+	}
+
+	void do_deallocate(void* p, std::size_t bytes, std::size_t alignment) override
+	{
+		if (!mapped(bytes, alignment))
+			upstream_->deallocate(p, bytes, alignment);
+		else
+			::munmap(p, round_up(bytes));
+	}
+
+	bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override
+	{
+		return this == &other;
+	}
+};
+
+}
@@ -0,0 +1,255 @@
+#pragma once
+
+#include "person.hpp"
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <bit>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+
+// What a HelixStream's storage is doing: how many reads and seeks, how many bytes, and how
+// long each call took. instrumented_stream wraps any HelixStream (and instrumented_person
+// any Person) and records into a stream_metrics, which copies of the stream and threads
+// comparing different chromosomes all share.
+
+namespace dna
+{
+
+// Counts of durations in log-linear buckets, like HdrHistogram: each power of two is split
+// into SUB_BUCKETS equal buckets, so any recorded value is known to within 1/SUB_BUCKETS
+// of itself, from nanoseconds up to hours. Recording is a relaxed atomic increment, so any
+// number of threads can record into one histogram at once.
+class latency_histogram
+{
+public:
+	static constexpr unsigned SUB_BUCKET_BITS = 4;
+	static constexpr std::size_t SUB_BUCKETS = std::size_t{1} << SUB_BUCKET_BITS;
+	// Values below SUB_BUCKETS are exact, then SUB_BUCKETS per power of two up to 2^64
+	static constexpr std::size_t BUCKETS = (64 - SUB_BUCKET_BITS + 1) * SUB_BUCKETS;
+
+private:
+	std::array<std::atomic<std::uint64_t>, BUCKETS> counts_{};
+	std::atomic<std::uint64_t> count_{0};
+	std::atomic<std::uint64_t> total_{0};
+	std::atomic<std::uint64_t> max_{0};
+
+public:
+	static constexpr std::size_t bucket(std::uint64_t value) noexcept
+	{
+		if (value < SUB_BUCKETS)
+			return static_cast<std::size_t>(value);
+
+		const unsigned exponent = static_cast<unsigned>(std::bit_width(value)) - 1;
+		const std::size_t sub = static_cast<std::size_t>(value >> (exponent - SUB_BUCKET_BITS)) & (SUB_BUCKETS - 1);
+		return (exponent - SUB_BUCKET_BITS + 1) * SUB_BUCKETS + sub;
+	}
+
+	// The smallest and largest values that land in a bucket
+	static constexpr std::uint64_t lowest(std::size_t bucket) noexcept
+	{
+		if (bucket < SUB_BUCKETS)
+			return bucket;
+
+		const unsigned shift = static_cast<unsigned>(bucket / SUB_BUCKETS) - 1;
+		return (SUB_BUCKETS + bucket % SUB_BUCKETS) << shift;
+	}
+
+	static constexpr std::uint64_t highest(std::size_t bucket) noexcept
+	{
+		if (bucket < SUB_BUCKETS)
+			return bucket;
+
+		const unsigned shift = static_cast<unsigned>(bucket / SUB_BUCKETS) - 1;
+		return lowest(bucket) + ((std::uint64_t{1} << shift) - 1);
+	}
+
+	void record(std::uint64_t nanoseconds) noexcept
+	{
+		counts_[bucket(nanoseconds)].fetch_add(1, std::memory_order_relaxed);
+		count_.fetch_add(1, std::memory_order_relaxed);
+		total_.fetch_add(nanoseconds, std::memory_order_relaxed);
+
+		auto max = max_.load(std::memory_order_relaxed);
+		while (nanoseconds > max && !max_.compare_exchange_weak(max, nanoseconds, std::memory_order_relaxed))
+		{ }
+	}
+
+	// Adds everything recorded by other, e.g. to sum up per-thread histograms
+	void merge(const latency_histogram& other) noexcept
+	{
+		for (std::size_t i = 0; i < BUCKETS; ++i)
+		{
+			if (const auto n = other.counts_[i].load(std::memory_order_relaxed))
+				counts_[i].fetch_add(n, std::memory_order_relaxed);
+		}
+		count_.fetch_add(other.count(), std::memory_order_relaxed);
+		total_.fetch_add(other.total(), std::memory_order_relaxed);
+
+		const auto other_max = other.max();
+		auto max = max_.load(std::memory_order_relaxed);
+		while (other_max > max && !max_.compare_exchange_weak(max, other_max, std::memory_order_relaxed))
+		{ }
+	}
+
+	void reset() noexcept
+	{
+		for (auto& n : counts_)
+			n.store(0, std::memory_order_relaxed);
+		count_.store(0, std::memory_order_relaxed);
+		total_.store(0, std::memory_order_relaxed);
+		max_.store(0, std::memory_order_relaxed);
+	}
+
+	std::uint64_t count() const noexcept
+	{
+		return count_.load(std::memory_order_relaxed);
+	}
+
+	std::uint64_t count(std::size_t bucket) const noexcept
+	{
+		return counts_[bucket].load(std::memory_order_relaxed);
+	}
+
+	std::uint64_t total() const noexcept
+	{
+		return total_.load(std::memory_order_relaxed);
+	}
+
+	std::uint64_t max() const noexcept
+	{
+		return max_.load(std::memory_order_relaxed);
+	}
+
+	double mean() const noexcept
+	{
+		const auto n = count();
+		return n == 0 ? 0.0 : static_cast<double>(total()) / static_cast<double>(n);
+	}
+
+	// The value that fraction (0 to 1) of the recorded values are at or below, rounded up to
+	// the end of its bucket (but never past the largest value recorded)
+	std::uint64_t percentile(double fraction) const noexcept
+	{
+		const auto n = count();
+		if (n == 0)
+			return 0;
+
+		const auto rank = std::max<std::uint64_t>(1, static_cast<std::uint64_t>(std::clamp(fraction, 0.0, 1.0) * static_cast<double>(n) + 0.5));
+		std::uint64_t seen = 0;
+		for (std::size_t i = 0; i < BUCKETS; ++i)
+		{
+			seen += count(i);
+			if (seen >= rank)
+				return std::min(highest(i), max());
+		}
+		return max();
+	}
+};
+
+// Everything recorded about one or more streams. Safe to record into from any thread.
+struct stream_metrics
+{
+	std::atomic<std::uint64_t> reads{0};
+	std::atomic<std::uint64_t> seeks{0};
+	std::atomic<std::uint64_t> bytes_read{0};
+	latency_histogram read_latency;
+	latency_histogram seek_latency;
+
+	void reset() noexcept
+	{
+		reads.store(0, std::memory_order_relaxed);
+		seeks.store(0, std::memory_order_relaxed);
+		bytes_read.store(0, std::memory_order_relaxed);
+		read_latency.reset();
+		seek_latency.reset();
+	}
+};
+
+// Passes everything through to a HelixStream, timing each read() and seek() into a shared
+// stream_metrics. Copies record into the same metrics.
+template<HelixStream H>
+class instrumented_stream
+{
+	using clock = std::chrono::steady_clock;
+
+	H helix_;
+	std::shared_ptr<stream_metrics> metrics_;
+
+	static std::uint64_t since(clock::time_point start) noexcept
+	{
+		return static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(clock::now() - start).count());
+	}
+
+public:
+	instrumented_stream(H helix, std::shared_ptr<stream_metrics> metrics) :
+			helix_(std::move(helix)),
+			metrics_(std::move(metrics))
+	{ }
+
+	void seek(long offset)
+	{
+		const auto start = clock::now();
+		helix_.seek(offset);
+		metrics_->seek_latency.record(since(start));
+		metrics_->seeks.fetch_add(1, std::memory_order_relaxed);
+	}
+
+	auto size() const
+	{
+		return helix_.size();
+	}
+
+	auto read()
+	{
+		const auto start = clock::now();
+		auto seq = helix_.read();
+		metrics_->read_latency.record(since(start));
+		metrics_->reads.fetch_add(1, std::memory_order_relaxed);
+		metrics_->bytes_read.fetch_add((seq.size() + packed_size::value - 1) / packed_size::value, std::memory_order_relaxed);
+		return seq;
+	}
+
+	const stream_metrics& metrics() const noexcept
+	{
+		return *metrics_;
+	}
+
+	const H& underlying() const noexcept
+	{
+		return helix_;
+	}
+};
+
+// A Person whose chromosomes are instrumented_streams, all recording into the same metrics
+template<Person P>
+class instrumented_person
+{
+	const P& person_;
+	std::shared_ptr<stream_metrics> metrics_;
+
+public:
+	explicit instrumented_person(const P& person, std::shared_ptr<stream_metrics> metrics = std::make_shared<stream_metrics>()) :
+			person_(person),
+			metrics_(std::move(metrics))
+	{ }
+
+	instrumented_stream<chromosome_t<P>> chromosome(std::size_t chromosome_index) const
+	{
+		return {person_.chromosome(chromosome_index), metrics_};
+	}
+
+	std::size_t chromosomes() const
+	{
+		return person_.chromosomes();
+	}
+
+	const stream_metrics& metrics() const noexcept
+	{
+		return *metrics_;
+	}
+};
+
+}
@@ -0,0 +1,360 @@
+#pragma once
+
+#include "difference.hpp"
+#include "difference_table.hpp"
+
+#include <algorithm>
+#include <bit>
+#include <cstdint>
+#include <memory_resource>
+#include <span>
+#include <stdexcept>
+#include <vector>
+
+namespace dna
+{
+	// Read-only view of a serialized IntervalIndex. The serialized form is what gets queried,
+	// so an index written to disk can be memory-mapped by a later job and used immediately.
+	//
+	// Layout (native-endian 64-bit words):
+	//   header:       magic | version << 32, sample, # of chromosomes C, # of intervals N
+	//   chromosomes:  C x (first interval, # of intervals)
+	//   starts:       N
+	//   ends:         N (insertions are widened to cover the position they were inserted at)
+	//   max ends:     N (the augmented value: greatest end within each implicit subtree)
+	//   ids:          N x 32 bits, padded to a whole word
+	//
+	// Intervals are sorted by start within each chromosome, and each chromosome's slice is an
+	// implicit binary search tree: a node at level k has its lowest k bits set and bit k clear,
+	// so no child pointers are stored. Queries are O(log n + k).
+	class IntervalIndexView
+	{
+	public:
+		static constexpr std::uint64_t MAGIC = 0x49414E44; // "DNAI"
+		static constexpr std::uint64_t VERSION = 1;
+		static constexpr size_t HEADER_WORDS = 4;
+
+	private:
+		// Subtrees at or below this level are scanned linearly
+		static constexpr int SCAN_LEVEL = 3;
+
+		Sample sample_ = Sample::A;
+		std::span<const std::uint64_t> chromosomes_{};
+		std::span<const std::uint64_t> starts_{};
+		std::span<const std::uint64_t> ends_{};
+		std::span<const std::uint64_t> max_ends_{};
+		std::span<const std::uint32_t> ids_{};
+
+	public:
+		IntervalIndexView() = default;
+
+		// Validates and wraps serialized bytes, which must stay alive and 8-byte aligned.
+		// Throws std::invalid_argument if they don't hold an index.
+		static IntervalIndexView fromBytes(std::span<const std::byte> bytes)
+		{
+			if (reinterpret_cast<std::uintptr_t>(bytes.data()) % alignof(std::uint64_t) != 0)
+			{
+				throw std::invalid_argument("interval index must be 8-byte aligned");
+			}
+
+			const std::span<const std::uint64_t> words(reinterpret_cast<const std::uint64_t*>(bytes.data()), bytes.size() / sizeof(std::uint64_t));
+			if (words.size() < HEADER_WORDS || words[0] != (MAGIC | (VERSION << 32)))
+			{
+				throw std::invalid_argument("not a serialized interval index");
+			}
+
+			// Bounded by the words there are before serializedWords() can overflow on them
+			const size_t num_chromosomes = words[2];
+			const size_t n = words[3];
+			const size_t body = words.size() - HEADER_WORDS;
+			if (num_chromosomes > body / 2 || n > body / 3 || words.size() < serializedWords(num_chromosomes, n))
+			{
+				throw std::invalid_argument("truncated interval index");
+			}
+
+			IntervalIndexView view{};
+			view.sample_ = words[1] == 0 ? Sample::A : Sample::B;
+			size_t offset = HEADER_WORDS;
+			view.chromosomes_ = words.subspan(offset, 2 * num_chromosomes);
+			offset += 2 * num_chromosomes;
+			view.starts_ = words.subspan(offset, n);
+			offset += n;
+			view.ends_ = words.subspan(offset, n);
+			offset += n;
+			view.max_ends_ = words.subspan(offset, n);
+			offset += n;
+			view.ids_ = std::span<const std::uint32_t>(reinterpret_cast<const std::uint32_t*>(words.data() + offset), n);
+
+			for (size_t c = 0; c < num_chromosomes; ++c)
+			{
+				if (view.chromosomes_[2 * c] + view.chromosomes_[2 * c + 1] > n)
+				{
+					throw std::invalid_argument("corrupt interval index");
+				}
+			}
+
+			return view;
+		}
+
+		static constexpr size_t serializedWords(size_t num_chromosomes, size_t n) noexcept
+		{
+			return HEADER_WORDS + 2 * num_chromosomes + 3 * n + (n + 1) / 2;
+		}
+
+		Sample sample() const noexcept
+		{
+			return sample_;
+		}
+
+		size_t size() const noexcept
+		{
+			return starts_.size();
+		}
+
+		// Calls f(id) for every interval on chromosome_idx overlapping [start, end)
+		template <typename F>
+		void overlapping(size_t chromosome_idx, std::uint64_t start, std::uint64_t end, F&& f) const
+		{
+			if (chromosome_idx >= chromosomes_.size() / 2 || start >= end)
+			{
+				return;
+			}
+
+			const size_t first = chromosomes_[2 * chromosome_idx];
+			const auto n = static_cast<std::int64_t>(chromosomes_[2 * chromosome_idx + 1]);
+			if (n == 0)
+			{
+				return;
+			}
+
+			const auto* starts = starts_.data() + first;
+			const auto* ends = ends_.data() + first;
+			const auto* max_ends = max_ends_.data() + first;
+			const auto* ids = ids_.data() + first;
+
+			struct Frame
+			{
+				std::int64_t node;
+				int level;
+				bool left_done;
+			};
+
+			Frame stack[64];
+			int top = 0;
+			const int max_level = static_cast<int>(std::bit_width(static_cast<std::uint64_t>(n))) - 1;
+			stack[top++] = {(std::int64_t{1} << max_level) - 1, max_level, false};
+
+			while (top > 0)
+			{
+				const Frame z = stack[--top];
+
+				if (z.level <= SCAN_LEVEL)
+				{
+					// Small subtree: scan its slice of the sorted array
+					const std::int64_t i0 = z.node >> z.level << z.level;
+					const std::int64_t i1 = std::min(n, i0 + (std::int64_t{1} << (z.level + 1)) - 1);
+					for (std::int64_t i = i0; i < i1 && starts[i] < end; ++i)
+					{
+						if (start < ends[i])
+						{
+							f(ids[i]);
+						}
+					}
+				}
+				else if (!z.left_done)
+				{
+					// Revisit this node after its left child, which only needs visiting if it
+					// (or anything beneath it) ends after the query starts
+					const std::int64_t left = z.node - (std::int64_t{1} << (z.level - 1));
+					stack[top++] = {z.node, z.level, true};
+					if (left >= n || max_ends[left] > start)
+					{
+						stack[top++] = {left, z.level - 1, false};
+					}
+				}
+				else if (z.node < n && starts[z.node] < end)
+				{
+					// Nothing to the right can overlap once starts pass the end of the query
+					if (start < ends[z.node])
+					{
+						f(ids[z.node]);
+					}
+					stack[top++] = {z.node + (std::int64_t{1} << (z.level - 1)), z.level - 1, false};
+				}
+			}
+		}
+
+		std::vector<std::uint32_t> overlapping(size_t chromosome_idx, std::uint64_t start, std::uint64_t end) const
+		{
+			std::vector<std::uint32_t> ret{};
+			overlapping(chromosome_idx, start, end, [&ret](std::uint32_t id) { ret.push_back(id); });
+			return ret;
+		}
+	};
+
+	// Immutable interval index over one person pair's Differences, in one sample's
+	// coordinates. Ids are the positions of the Differences in the input. The serialized
+	// words come from the given memory resource, e.g. a huge_page_resource for a large index.
+	class IntervalIndex
+	{
+		std::pmr::vector<std::uint64_t> words_;
+		IntervalIndexView view_;
+
+	public:
+		static IntervalIndex build(std::span<const Difference> differences, Sample sample = Sample::A,
+				std::pmr::memory_resource* resource = std::pmr::get_default_resource())
+		{
+			std::vector<Interval> intervals(differences.size());
+			for (size_t i = 0; i < differences.size(); ++i)
+			{
+				const auto& region = sample == Sample::A ? differences[i].person_a : differences[i].person_b;
+				intervals[i] = {differences[i].chromosome_idx, region.first, region.second, static_cast<std::uint32_t>(i)};
+			}
+			return IntervalIndex(std::move(intervals), sample, resource);
+		}
+
+		static IntervalIndex build(const DifferenceTable& table, Sample sample = Sample::A,
+				std::pmr::memory_resource* resource = std::pmr::get_default_resource())
+		{
+			const auto starts = table.starts(sample);
+			const auto ends = table.ends(sample);
+
+			std::vector<Interval> intervals(table.size());
+			for (size_t i = 0; i < intervals.size(); ++i)
+			{
+				intervals[i] = {table.chromosomes()[i], starts[i], ends[i], static_cast<std::uint32_t>(i)};
+			}
+			return IntervalIndex(std::move(intervals), sample, resource);
+		}
+
+		// Copies take their memory from the same resource
+		IntervalIndex(const IntervalIndex& other) :
+				words_{other.words_, other.words_.get_allocator()}, view_{IntervalIndexView::fromBytes(bytes())}
+		{}
+
+		IntervalIndex(IntervalIndex&&) noexcept = default;
+
+		// Keeps this index's memory resource, copying the words over if the other's differs
+		IntervalIndex& operator=(IntervalIndex other)
+		{
+			words_ = std::move(other.words_);
+			view_ = IntervalIndexView::fromBytes(bytes());
+			return *this;
+		}
+
+		// The serialized index; write these bytes out to share the index with other jobs
+		std::span<const std::byte> bytes() const noexcept
+		{
+			return std::as_bytes(std::span<const std::uint64_t>(words_));
+		}
+
+		const IntervalIndexView& view() const noexcept
+		{
+			return view_;
+		}
+
+		template <typename F>
+		void overlapping(size_t chromosome_idx, std::uint64_t start, std::uint64_t end, F&& f) const
+		{
+			view_.overlapping(chromosome_idx, start, end, std::forward<F>(f));
+		}
+
+		std::vector<std::uint32_t> overlapping(size_t chromosome_idx, std::uint64_t start, std::uint64_t end) const
+		{
+			return view_.overlapping(chromosome_idx, start, end);
+		}
+
+	private:
+		struct Interval
+		{
+			size_t chromosome_idx;
+			std::uint64_t start;
+			std::uint64_t end;
+			std::uint32_t id;
+		};
+
+		IntervalIndex(std::vector<Interval> intervals, Sample sample, std::pmr::memory_resource* resource) :
+				words_{resource}
+		{
+			std::sort(intervals.begin(), intervals.end(), [](const Interval& l, const Interval& r) {
+				return l.chromosome_idx != r.chromosome_idx ? l.chromosome_idx < r.chromosome_idx : l.start < r.start;
+			});
+
+			const size_t n = intervals.size();
+			const size_t num_chromosomes = n == 0 ? 0 : intervals.back().chromosome_idx + 1;
+
+			words_.assign(IntervalIndexView::serializedWords(num_chromosomes, n), 0);
+			words_[0] = IntervalIndexView::MAGIC | (IntervalIndexView::VERSION << 32);
+			words_[1] = sample == Sample::A ? 0 : 1;
+			words_[2] = num_chromosomes;
+			words_[3] = n;
+
+			auto* chromosomes = words_.data() + IntervalIndexView::HEADER_WORDS;
+			auto* starts = chromosomes + 2 * num_chromosomes;
+			auto* ends = starts + n;
+			auto* max_ends = ends + n;
+			auto* ids = reinterpret_cast<std::uint32_t*>(max_ends + n);
+
+			for (size_t i = 0; i < n; ++i)
+			{
+				const auto& interval = intervals[i];
+				starts[i] = interval.start;
+				// An insertion is empty in one sample; make it cover the position it's at
+				ends[i] = interval.end + (interval.end == interval.start);
+				ids[i] = interval.id;
+				++chromosomes[2 * interval.chromosome_idx + 1];
+			}
+
+			size_t first = 0;
+			for (size_t c = 0; c < num_chromosomes; ++c)
+			{
+				chromosomes[2 * c] = first;
+				const size_t count = chromosomes[2 * c + 1];
+				augment(ends + first, max_ends + first, static_cast<std::int64_t>(count));
+				first += count;
+			}
+
+			view_ = IntervalIndexView::fromBytes(bytes());
+		}
+
+		// Computes every node's max end, bottom up
+		static void augment(const std::uint64_t* ends, std::uint64_t* max_ends, std::int64_t n)
+		{
+			if (n == 0)
+			{
+				return;
+			}
+
+			// The rightmost node at the current level, and its max end, stand in for
+			// right children that fall off the end of the array
+			std::int64_t last_i = 0;
+			std::uint64_t last = 0;
+			for (std::int64_t i = 0; i < n; i += 2)
+			{
+				last_i = i;
+				last = max_ends[i] = ends[i];
+			}
+			for (std::int64_t i = 1; i < n; i += 2)
+			{
+				max_ends[i] = ends[i];
+			}
+
+			for (int k = 1; (std::int64_t{1} << k) <= n; ++k)
+			{
+				const std::int64_t x = std::int64_t{1} << (k - 1);
+				for (std::int64_t i = (x << 1) - 1; i < n; i += x << 2)
+				{
+					const std::uint64_t left = max_ends[i - x];
+					const std::uint64_t right = i + x < n ? max_ends[i + x] : last;
+					max_ends[i] = std::max({ends[i], left, right});
+				}
+
+				last_i = ((last_i >> k) & 1) ? last_i - x : last_i + x;
+				if (last_i < n && max_ends[last_i] > last)
+				{
+					last = max_ends[last_i];
+				}
+			}
+		}
+	};
+}
@@ -2,6 +2,10 @@
 
 #include "sequence_buffer.hpp"
 
+#include <concepts>
+#include <type_traits>
+#include <utility>
+
 namespace dna
 {
 
@@ -12,11 +16,16 @@ concept HelixStream = requires(T a) {
 	{ a.size() } -> std::convertible_to<std::size_t>;
 };
 
+// The chromosome handed out by a Person. Comparisons take a copy of it, so copying must
+// be cheap: copies share the underlying data and each only has its own read position.
+template<typename T>
+using chromosome_t = std::remove_cvref_t<decltype(std::declval<const T&>().chromosome(1))>;
+
 template<typename T>
 concept Person = requires(T a) {
 	{ a.chromosome(1) };
 	{ a.chromosomes() } -> std::convertible_to<std::size_t>;
-};
+} && HelixStream<chromosome_t<T>> && std::copy_constructible<chromosome_t<T>>;
 
 }
 
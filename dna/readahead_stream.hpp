@@ -0,0 +1,251 @@
+#pragma once
+
+#include "person.hpp"
+
+#include <algorithm>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <mutex>
+#include <span>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+namespace dna
+{
+
+// Reads ahead of its consumer on a background thread, so that storage latency overlaps
+// with comparing the chunks already read. Up to depth chunks are kept in a ring: the I/O
+// thread fills free slots in order while read() hands out filled ones, each valid until the
+// next call to read().
+//
+// Streams that can read at a position (read_at(offset, span<byte>), like
+// procedural_stream) are read in chunks of chunk_size bytes; anything else is read with
+// its own read(), and chunk_size only sizes the initial buffers.
+//
+// The I/O thread is only started by the first read() or seek(), so copies that are never
+// read cost nothing. A copy starts from the same position, with a ring of its own.
+template<HelixStream H>
+class readahead_stream
+{
+public:
+	static constexpr std::size_t DEFAULT_DEPTH = 4;
+	static constexpr std::size_t DEFAULT_CHUNK_SIZE = 1 << 16;
+
+private:
+	struct slot
+	{
+		std::vector<std::byte> bytes;
+		std::size_t bases = 0;
+	};
+
+	static constexpr bool POSITIONAL = requires(H h, long offset, std::span<std::byte> out) {
+		{ h.read_at(offset, out) } -> std::convertible_to<std::size_t>;
+	};
+
+	H source_; // untouched by the I/O thread, for copying
+	H helix_;
+	std::size_t depth_;
+	std::size_t chunk_size_;
+	long size_;
+	long position_;  // of the next byte read() hands out
+
+	std::mutex mutex_;
+	std::condition_variable cv_;
+	// depth_ slots can be filled while the consumer holds one more
+	std::vector<slot> slots_;
+	std::size_t head_;        // next slot read() hands out
+	std::size_t ready_;       // filled slots from head_ on
+	std::uint64_t generation_; // bumped by every seek(), so stale reads are thrown away
+	long fill_position_;      // of the next byte the I/O thread reads
+	bool drained_;
+	bool stop_;
+	std::exception_ptr error_;
+	std::jthread thread_;
+
+	void run()
+	{
+		std::uint64_t positioned = UINT64_MAX;
+		std::unique_lock lock(mutex_);
+		while (true)
+		{
+			cv_.wait(lock, [&] { return stop_ || (ready_ < depth_ && !drained_ && !error_); });
+			if (stop_)
+				return;
+
+			const std::uint64_t generation = generation_;
+			const long offset = fill_position_;
+			slot& s = slots_[(head_ + ready_) % slots_.size()];
+			lock.unlock();
+
+			std::size_t bytes = 0;
+			std::exception_ptr error;
+			try
+			{
+				if constexpr (POSITIONAL)
+				{
+					s.bytes.resize(chunk_size_);
+					bytes = helix_.read_at(offset, s.bytes);
+					s.bytes.resize(bytes);
+					s.bases = bytes * packed_size::value;
+				}
+				else
+				{
+					if (positioned != generation)
+					{
+						helix_.seek(offset);
+						positioned = generation;
+					}
+					auto seq = helix_.read();
+					bytes = (seq.size() + packed_size::value - 1) / packed_size::value;
+					s.bytes.resize(bytes);
+					for (std::size_t i = 0; i < bytes; ++i)
+						s.bytes[i] = seq.buffer()[i];
+					s.bases = seq.size();
+				}
+			}
+			catch (...)
+			{
+				error = std::current_exception();
+			}
+
+			lock.lock();
+			if (generation != generation_)
+				continue;
+
+			if (error)
+			{
+				error_ = error;
+			}
+			else
+			{
+				fill_position_ += static_cast<long>(bytes);
+				drained_ = bytes == 0;
+				++ready_;
+			}
+			cv_.notify_all();
+		}
+	}
+
+	// Called with the lock held
+	void start()
+	{
+		if (!thread_.joinable())
+			thread_ = std::jthread([this] { run(); });
+	}
+
+public:
+	explicit readahead_stream(H helix, std::size_t depth = DEFAULT_DEPTH, std::size_t chunk_size = DEFAULT_CHUNK_SIZE) :
+			source_(helix),
+			helix_(std::move(helix)),
+			depth_(depth),
+			chunk_size_(chunk_size),
+			size_(static_cast<long>(helix_.size())),
+			position_(0),
+			slots_(depth + 1),
+			head_(0),
+			ready_(0),
+			generation_(0),
+			fill_position_(0),
+			drained_(false),
+			stop_(false)
+	{
+		if (depth_ == 0 || chunk_size_ == 0)
+			throw std::invalid_argument("read ahead depth and chunk size must be at least 1");
+
+		for (auto& s : slots_)
+			s.bytes.reserve(chunk_size_);
+	}
+
+	readahead_stream(const readahead_stream& other) :
+			readahead_stream(other.source_, other.depth_, other.chunk_size_)
+	{
+		position_ = other.position_;
+		fill_position_ = other.position_;
+	}
+
+	readahead_stream& operator=(const readahead_stream&) = delete;
+
+	~readahead_stream()
+	{
+		{
+			std::lock_guard lock(mutex_);
+			stop_ = true;
+		}
+		cv_.notify_all();
+	}
+
+	void seek(long offset)
+	{
+		std::unique_lock lock(mutex_);
+		position_ = std::clamp(offset, 0L, size_);
+		fill_position_ = position_;
+		ready_ = 0;
+		drained_ = false;
+		error_ = nullptr;
+		++generation_;
+		start();
+		cv_.notify_all();
+	}
+
+	long size() const
+	{
+		return size_;
+	}
+
+	// The next chunk; valid until the next call to read() or seek(). Rethrows anything the
+	// underlying stream threw while reading it.
+	sequence_buffer<std::span<const std::byte>> read()
+	{
+		std::unique_lock lock(mutex_);
+		start();
+		cv_.wait(lock, [&] { return ready_ > 0 || drained_ || error_; });
+		if (ready_ == 0)
+		{
+			if (error_)
+				std::rethrow_exception(error_);
+			return {std::span<const std::byte>(), 0};
+		}
+
+		const slot& s = slots_[head_];
+		head_ = (head_ + 1) % slots_.size();
+		--ready_;
+		position_ += static_cast<long>(s.bytes.size());
+		cv_.notify_all();
+
+		return {std::span<const std::byte>(s.bytes.data(), s.bytes.size()), s.bases};
+	}
+};
+
+// A Person whose chromosomes are each read ahead on their own I/O thread
+template<Person P>
+class readahead_person
+{
+	const P& person_;
+	std::size_t depth_;
+	std::size_t chunk_size_;
+
+public:
+	using stream = readahead_stream<chromosome_t<P>>;
+
+	explicit readahead_person(const P& person, std::size_t depth = stream::DEFAULT_DEPTH,
+			std::size_t chunk_size = stream::DEFAULT_CHUNK_SIZE) :
+			person_(person),
+			depth_(depth),
+			chunk_size_(chunk_size)
+	{ }
+
+	stream chromosome(std::size_t chromosome_index) const
+	{
+		return stream(person_.chromosome(chromosome_index), depth_, chunk_size_);
+	}
+
+	std::size_t chromosomes() const
+	{
+		return person_.chromosomes();
+	}
+};
+
+}
@@ -0,0 +1,363 @@
+#pragma once
+
+#include "anchored_position.hpp"
+#include "comparator.hpp"
+#include "difference_table.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <exception>
+#include <memory_resource>
+#include <mutex>
+#include <optional>
+#include <ranges>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+namespace dna
+{
+	enum class RegionStatus
+	{
+		Found,
+		// The chromosome has no telomere at the front to measure the region's position from
+		Unanchored,
+		// Nothing resembling the region was found near where it should be
+		NotFound,
+	};
+
+	struct RegionOptions
+	{
+		// How far (in bases) either side of its expected position a region is searched for
+		size_t search_slack = 1 << 12;
+		// # of telomere bases needed at the front of a chromosome to anchor a region, at least
+		// one whole TTAGGG repeat
+		size_t min_telomere = TelomereAnchor::DEFAULT_MIN_TELOMERE;
+		// Worker threads used for a batch of people, 0 for one per hardware thread
+		size_t threads = 0;
+		CompareOptions compare{};
+		// Where the extracted region and its anchors are kept
+		std::pmr::memory_resource* resource = std::pmr::get_default_resource();
+	};
+
+	struct RegionResult
+	{
+		RegionStatus status = RegionStatus::Found;
+		// [start, end) of the region in this person, as base indices
+		Difference::subsection location{};
+		// person_a is the region as it was extracted, person_b is this person
+		std::vector<Difference> differences;
+		// How far comparing a region that was found got. Unless it completed (e.g. it was cut
+		// short by RegionOptions::compare.max_differences), differences is only the start.
+		ComparisonStatus comparison{};
+	};
+
+	// Compares one region of one person (usually a Difference found by Comparator::compare)
+	// against many other people. The region is read and indexed once, up front; after that,
+	// comparing against a person only reads the telomeres at the front of their chromosome
+	// and a window around where the region should be.
+	//
+	// A region's position is measured from the end of the telomeres, since that's the only
+	// point that means the same thing in everyone. Within the search window it is then
+	// pinned down exactly by looking for short k-mers (anchors) sampled from the region.
+	template <AlignmentPolicy Policy = adaptive_policy<>>
+	class RegionComparator
+	{
+		// Anchors are k-mers of this many bases, packed 2 bits per base
+		static constexpr size_t ANCHOR_LENGTH = 16;
+		// Distance between the start of consecutive anchors sampled from the region
+		static constexpr size_t ANCHOR_SPACING = 64;
+
+		struct Anchor
+		{
+			std::uint32_t kmer;
+			std::uint32_t offset; // into the region
+		};
+
+		RegionOptions options_;
+		size_t chromosome_idx_;
+		size_t start_;
+		// Distance from the end of the telomeres to the start of the region
+		size_t offset_;
+		std::pmr::vector<base> region_;
+		// Sorted by k-mer
+		std::pmr::vector<Anchor> anchors_;
+
+	public:
+		// Extracts [start, end) of a chromosome of source. Throws std::invalid_argument if the
+		// chromosome has no telomere to anchor the region to, or the region isn't after it.
+		template <Person P>
+		RegionComparator(const P& source, size_t chromosome_idx, size_t start, size_t end, RegionOptions options = {}) :
+				options_{std::move(options)}, chromosome_idx_{chromosome_idx}, start_{start}, offset_{0},
+				region_{options_.resource}, anchors_{options_.resource}
+		{
+			auto helix = source.chromosome(chromosome_idx);
+			load(helix, findTelomere(helix), start, end);
+		}
+
+		template <Person P>
+		RegionComparator(const P& source, const Difference& d, Sample sample, RegionOptions options = {}) :
+				RegionComparator(source, d.chromosome_idx,
+						sample == Sample::A ? d.person_a.first : d.person_b.first,
+						sample == Sample::A ? d.person_a.second : d.person_b.second,
+						std::move(options))
+		{}
+
+		// length bases starting at an anchored position of source
+		template <Person P>
+		RegionComparator(const P& source, AnchoredPosition start, size_t length, RegionOptions options = {}) :
+				options_{std::move(options)}, chromosome_idx_{start.chromosome_idx}, start_{0}, offset_{0},
+				region_{options_.resource}, anchors_{options_.resource}
+		{
+			auto helix = source.chromosome(chromosome_idx_);
+			const auto telomere = findTelomere(helix);
+
+			start_ = telomere.resolve(start.offset).base_idx;
+			if (start_ >= static_cast<size_t>(helix.size()) * packed_size::value)
+			{
+				throw std::invalid_argument("region start can't be resolved in its own chromosome");
+			}
+			load(helix, telomere, start_, start_ + length);
+		}
+
+		size_t chromosomeIdx() const noexcept
+		{
+			return chromosome_idx_;
+		}
+
+		// Where the region starts, in terms that mean the same thing in every person
+		AnchoredPosition anchoredStart() const noexcept
+		{
+			return AnchoredPosition{chromosome_idx_, offset_};
+		}
+
+		base_span region() const noexcept
+		{
+			return region_;
+		}
+
+		template <Person P>
+		RegionResult compare(const P& person) const
+		{
+			Policy policy{};
+			std::vector<base> window{};
+			return compare(person, policy, window);
+		}
+
+		// Compares against every person in parallel, returning a result per person in the
+		// same order. Each worker has its own policy and buffers, and shares the region.
+		template <std::ranges::random_access_range People>
+			requires Person<std::ranges::range_value_t<People>>
+		std::vector<RegionResult> compare(const People& people) const
+		{
+			const size_t count = std::ranges::size(people);
+			std::vector<RegionResult> results(count);
+			std::atomic<size_t> next{0};
+			std::exception_ptr error{};
+			std::mutex error_mutex{};
+
+			auto work = [&] {
+				Policy policy{};
+				std::vector<base> window{};
+				for (size_t i = next++; i < count; i = next++)
+				{
+					try
+					{
+						results[i] = compare(std::ranges::begin(people)[i], policy, window);
+					}
+					catch (...)
+					{
+						std::lock_guard lock(error_mutex);
+						if (!error)
+						{
+							error = std::current_exception();
+						}
+					}
+				}
+			};
+
+			size_t threads = options_.threads > 0 ? options_.threads : std::max(1u, std::thread::hardware_concurrency());
+			threads = std::min(threads, count);
+
+			{
+				std::vector<std::jthread> workers{};
+				for (size_t i = 1; i < threads; ++i)
+				{
+					workers.emplace_back(work);
+				}
+				work();
+			}
+
+			if (error)
+			{
+				std::rethrow_exception(error);
+			}
+			return results;
+		}
+
+	private:
+		template <HelixStream H>
+		TelomereAnchor findTelomere(H& helix) const
+		{
+			auto telomere = TelomereAnchor::find(helix, options_.min_telomere);
+			if (!telomere)
+			{
+				throw std::invalid_argument("chromosome has no telomere to anchor the region to");
+			}
+			return *telomere;
+		}
+
+		// Reads [start, end) of helix, whose telomeres have already been found
+		template <HelixStream H>
+		void load(H& helix, const TelomereAnchor& telomere, size_t start, size_t end)
+		{
+			if (start < telomere.dataStart() || end < start || end > static_cast<size_t>(helix.size()) * packed_size::value)
+			{
+				throw std::invalid_argument("region is not within the chromosome's data");
+			}
+
+			offset_ = telomere.offsetOf(start);
+			read_bases(helix, start, end, region_);
+			buildAnchors();
+		}
+
+		void buildAnchors()
+		{
+			if (region_.size() < ANCHOR_LENGTH)
+			{
+				return;
+			}
+
+			const size_t last = region_.size() - ANCHOR_LENGTH;
+			for (size_t offset = 0;; offset = std::min(offset + ANCHOR_SPACING, last))
+			{
+				std::uint32_t kmer = 0;
+				for (size_t i = 0; i < ANCHOR_LENGTH; ++i)
+				{
+					kmer = (kmer << 2) | static_cast<std::uint32_t>(region_[offset + i]);
+				}
+				anchors_.push_back({kmer, static_cast<std::uint32_t>(offset)});
+
+				if (offset == last)
+				{
+					break;
+				}
+			}
+
+			std::sort(anchors_.begin(), anchors_.end(), [](const Anchor& l, const Anchor& r) { return l.kmer < r.kmer; });
+		}
+
+		template <Person P>
+		RegionResult compare(const P& person, Policy& policy, std::vector<base>& window) const
+		{
+			RegionResult result{};
+
+			auto helix = person.chromosome(chromosome_idx_);
+			auto telomere = TelomereAnchor::find(helix, options_.min_telomere);
+			if (!telomere)
+			{
+				result.status = RegionStatus::Unanchored;
+				return result;
+			}
+
+			// Seek straight to the region instead of scanning up to it
+			const size_t helix_end = static_cast<size_t>(helix.size()) * packed_size::value;
+			const size_t expected = telomere->resolve(offset_).base_idx;
+			if (expected > helix_end)
+			{
+				result.status = RegionStatus::NotFound;
+				return result;
+			}
+
+			const size_t window_start = expected - std::min(offset_, options_.search_slack);
+			const size_t window_end = std::min(helix_end, expected + region_.size() + options_.search_slack);
+			read_bases(helix, window_start, window_end, window);
+
+			auto location = locate(window, window_start, expected);
+			if (!location)
+			{
+				result.status = RegionStatus::NotFound;
+				return result;
+			}
+
+			result.location = *location;
+			span_cursor cursor_a(region_, start_);
+			span_cursor cursor_b(base_span(window).subspan(location->first - window_start, location->second - location->first), location->first);
+			result.comparison = Comparator::compareRange(chromosome_idx_, cursor_a, cursor_b,
+					[&result](const Difference& d) { result.differences.push_back(d); },
+					options_.compare, policy);
+
+			return result;
+		}
+
+		// Finds [start, end) of the region within window, which begins at base window_start.
+		// The start comes from the first anchor found and the end from the last, each taking
+		// the occurrence closest to where the region was expected to be.
+		std::optional<Difference::subsection> locate(base_span window, size_t window_start, size_t expected) const
+		{
+			if (anchors_.empty())
+			{
+				// Too short to anchor; all there is to go on is the expected position
+				if (expected + region_.size() > window_start + window.size())
+				{
+					return std::nullopt;
+				}
+				return Difference::subsection{expected, expected + region_.size()};
+			}
+
+			constexpr size_t NO_HIT = SIZE_MAX;
+			const Anchor* first = nullptr;
+			const Anchor* last = nullptr;
+			size_t first_hit = NO_HIT;
+			size_t last_hit = NO_HIT;
+
+			auto distance = [](size_t x, size_t y) { return x > y ? x - y : y - x; };
+
+			std::uint32_t kmer = 0;
+			for (size_t i = 0; i < window.size(); ++i)
+			{
+				kmer = (kmer << 2) | static_cast<std::uint32_t>(window[i]);
+				if (i + 1 < ANCHOR_LENGTH)
+				{
+					continue;
+				}
+
+				const size_t position = window_start + i + 1 - ANCHOR_LENGTH;
+				auto [lo, hi] = std::equal_range(anchors_.begin(), anchors_.end(), Anchor{kmer, 0},
+						[](const Anchor& l, const Anchor& r) { return l.kmer < r.kmer; });
+
+				for (auto it = lo; it != hi; ++it)
+				{
+					const size_t anchor_expected = expected + it->offset;
+					if (!first || it->offset < first->offset ||
+							(it->offset == first->offset && distance(position, anchor_expected) < distance(first_hit, anchor_expected)))
+					{
+						first = &*it;
+						first_hit = position;
+					}
+					if (!last || it->offset > last->offset ||
+							(it->offset == last->offset && distance(position, anchor_expected) < distance(last_hit, anchor_expected)))
+					{
+						last = &*it;
+						last_hit = position;
+					}
+				}
+			}
+
+			if (!first)
+			{
+				return std::nullopt;
+			}
+
+			const size_t start = first_hit - std::min<size_t>(first_hit - window_start, first->offset);
+			const size_t end = std::min(window_start + window.size(), last_hit + (region_.size() - last->offset));
+			if (end < start)
+			{
+				return std::nullopt;
+			}
+
+			return Difference::subsection{start, end};
+		}
+	};
+}
@@ -0,0 +1,118 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <memory_resource>
+#include <new>
+#include <span>
+#include <type_traits>
+#include <vector>
+
+namespace dna
+{
+
+// Bump allocator for short-lived scratch space (DP rows, trace matrices, ...).
+// Everything handed out is released at once by reset(), which keeps the memory for
+// the next round. If a round needed more than the arena held, the arena grows to fit
+// at the next reset, so a steady workload stops allocating after the first few rounds.
+//
+// It is also a std::pmr::memory_resource, so pmr containers can take their memory from it.
+// Deallocation does nothing: memory only comes back at reset(), when nothing using the
+// arena may still be alive. An arena must not be moved while containers refer to it.
+class scratch_arena : public std::pmr::memory_resource
+{
+	static constexpr std::size_t ALIGNMENT = alignof(std::max_align_t);
+
+	std::unique_ptr<std::byte[]> buffer_;
+	std::size_t capacity_;
+	std::size_t used_;
+	// Allocations that didn't fit in buffer_ since the last reset
+	std::vector<std::unique_ptr<std::byte[]>> overflow_;
+	std::size_t overflow_bytes_;
+
+public:
+	explicit scratch_arena(std::size_t capacity = 0) :
+			buffer_(capacity > 0 ? std::make_unique<std::byte[]>(capacity) : nullptr),
+			capacity_(capacity),
+			used_(0),
+			overflow_(),
+			overflow_bytes_(0)
+	{ }
+
+	scratch_arena(scratch_arena&&) noexcept = default;
+	scratch_arena& operator=(scratch_arena&&) noexcept = default;
+
+	using std::pmr::memory_resource::allocate;
+
+	// Uninitialized space for count Ts, valid until the next reset()
+	template<typename T>
+	std::span<T> allocate(std::size_t count)
+	{
+		static_assert(std::is_trivially_destructible_v<T>, "scratch memory is never destroyed");
+		static_assert(alignof(T) <= ALIGNMENT, "over-aligned types aren't supported");
+
+		return std::span<T>(reinterpret_cast<T*>(allocate_bytes(count * sizeof(T))), count);
+	}
+
+	void reset()
+	{
+		if (overflow_bytes_ > 0)
+		{
+			capacity_ += overflow_bytes_;
+			buffer_ = std::make_unique_for_overwrite<std::byte[]>(capacity_);
+			overflow_.clear();
+			overflow_bytes_ = 0;
+		}
+
+		used_ = 0;
+	}
+
+	std::size_t capacity() const noexcept
+	{
+		return capacity_;
+	}
+
+protected:
+	void* do_allocate(std::size_t bytes, std::size_t alignment) override
+	{
+		if (alignment <= ALIGNMENT)
+			return allocate_bytes(bytes);
+
+		// Over-allocate, then align within the block
+		const auto address = reinterpret_cast<std::uintptr_t>(allocate_bytes(bytes + alignment));
+		return reinterpret_cast<void*>((address + alignment - 1) / alignment * alignment);
+	}
+
+	void do_deallocate(void*, std::size_t, std::size_t) override
+	{ }
+
+	bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override
+	{
+		return this == &other;
+	}
+
+private:
+	std::byte* allocate_bytes(std::size_t count)
+	{
+		const std::size_t bytes = round_up(count);
+
+		if (used_ + bytes <= capacity_)
+		{
+			std::byte* memory = buffer_.get() + used_;
+			used_ += bytes;
+			return memory;
+		}
+
+		overflow_.push_back(std::make_unique_for_overwrite<std::byte[]>(bytes));
+		overflow_bytes_ += bytes;
+		return overflow_.back().get();
+	}
+
+	static constexpr std::size_t round_up(std::size_t bytes) noexcept
+	{
+		return (bytes + ALIGNMENT - 1) / ALIGNMENT * ALIGNMENT;
+	}
+};
+
+}
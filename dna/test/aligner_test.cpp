@@ -0,0 +1,155 @@
+#include "catch.hpp"
+#include "sequence_builder.hpp"
+
+#include <alignment_policy.hpp>
+
+namespace
+{
+
+// Applies an edit at offset to a copy of the sequence: erase `erase` bases, then insert `insert`
+std::vector<dna::base> edit(std::vector<dna::base> seq, std::size_t offset, std::size_t erase, const std::vector<dna::base>& insert = {})
+{
+	seq.erase(seq.begin() + offset, seq.begin() + offset + erase);
+	seq.insert(seq.begin() + offset, insert.begin(), insert.end());
+	return seq;
+}
+
+}
+
+TEST_CASE("Window statistics describe the divergence", "[aligner]")
+{
+	auto a = random_bases(256, 1);
+
+	SECTION("Lone substitution")
+	{
+		auto b = a;
+		b[0] = other(b[0]);
+
+		auto stats = dna::measure(a, b, 16);
+		CHECK(stats.lone_substitution());
+		CHECK(stats.shift == 0);
+	}
+
+	SECTION("Deletion")
+	{
+		auto b = edit(a, 0, 3);
+
+		auto stats = dna::measure(a, b, 16);
+		CHECK_FALSE(stats.lone_substitution());
+		CHECK(stats.shift == 3);
+	}
+
+	SECTION("Insertion")
+	{
+		auto b = edit(a, 0, 0, random_bases(5, 2));
+		b[0] = other(a[0]);
+
+		auto stats = dna::measure(a, b, 16);
+		CHECK(stats.shift == -5);
+	}
+}
+
+TEST_CASE("Aligners find where windows resync", "[aligner]")
+{
+	auto a = random_bases(4096, 3);
+
+	SECTION("SNP")
+	{
+		auto b = a;
+		b[0] = other(b[0]);
+
+		auto result = dna::snp_aligner{}.align(a, b);
+		REQUIRE(result);
+		CHECK(result->a_length == 1);
+		CHECK(result->b_length == 1);
+
+		CHECK_FALSE(dna::snp_aligner{}.align(a, edit(a, 0, 2)));
+	}
+
+	SECTION("Short indel")
+	{
+		auto result = dna::shift_aligner{}.align(a, edit(a, 0, 7));
+		REQUIRE(result);
+		CHECK(result->a_length == 7);
+		CHECK(result->b_length == 0);
+
+		auto long_deletion = edit(a, 0, 100);
+		CHECK_FALSE(dna::shift_aligner{}.align(a, long_deletion));
+
+		// Straight from a shift that was already measured
+		const auto measured = dna::measure(a, edit(a, 0, 7), dna::shift_aligner::DEFAULT_MAX_SHIFT);
+		CHECK(measured.shift == 7);
+		REQUIRE(dna::shift_aligner::align(measured.shift));
+		CHECK(dna::shift_aligner::align(measured.shift)->a_length == 7);
+		CHECK(dna::shift_aligner::align(-3)->b_length == 3);
+		CHECK_FALSE(dna::shift_aligner::align(0));
+	}
+
+	SECTION("Large insertion")
+	{
+		auto inserted = random_bases(1500, 4);
+		inserted[0] = other(a[0]);
+		auto b = edit(a, 0, 0, inserted);
+
+		auto result = dna::anchor_aligner{}.align(a, b);
+		REQUIRE(result);
+		CHECK(result->a_length == 0);
+		CHECK(result->b_length == 1500);
+	}
+
+	SECTION("Replaced region")
+	{
+		// The replacement must differ from what it replaces at both ends
+		auto replacement = random_bases(40, 5);
+		replacement.front() = other(a[0]);
+		replacement.back() = other(a[29]);
+		auto b = edit(a, 0, 30, replacement);
+
+		auto result = dna::anchor_aligner{}.align(a, b);
+		REQUIRE(result);
+		CHECK(result->a_length == 30);
+		CHECK(result->b_length == 40);
+	}
+
+	SECTION("Nothing in common")
+	{
+		auto b = random_bases(512, 6);
+		b[0] = other(a[0]);
+		CHECK_FALSE(dna::anchor_aligner{}.align(dna::base_span(a).first(512), b));
+	}
+}
+
+TEST_CASE("Adaptive policy resolves every kind of window", "[aligner]")
+{
+	auto a = random_bases(4096, 7);
+	dna::adaptive_policy<> policy;
+
+	auto snp = a;
+	snp[10] = other(snp[10]);
+	auto [snp_a, snp_b] = policy.resolve(dna::base_span(a).subspan(10), dna::base_span(snp).subspan(10));
+	CHECK(snp_a == 1);
+	CHECK(snp_b == 1);
+
+	auto cluster = a;
+	cluster[0] = other(cluster[0]);
+	cluster[3] = other(cluster[3]);
+	auto [cluster_a, cluster_b] = policy.resolve(a, cluster);
+	CHECK(cluster_a == 4);
+	CHECK(cluster_b == 4);
+
+	auto [del_a, del_b] = policy.resolve(a, edit(a, 0, 4));
+	CHECK(del_a == 4);
+	CHECK(del_b == 0);
+
+	auto large = edit(a, 0, 900);
+	auto [large_a, large_b] = policy.resolve(a, large);
+	CHECK(large_a == 900);
+	CHECK(large_b == 0);
+
+	// Without any common ground the whole window is reported
+	auto unrelated = random_bases(100, 8);
+	unrelated[0] = other(a[0]);
+	auto [none_a, none_b] = policy.resolve(dna::base_span(a).first(100), unrelated);
+	CHECK(none_a == 100);
+	CHECK(none_b == 100);
+}
@@ -0,0 +1,66 @@
+#include "catch.hpp"
+#include "fake_person.hpp"
+#include "sequence_builder.hpp"
+
+#include <anchored_position.hpp>
+#include <region_comparator.hpp>
+
+namespace
+{
+
+fake_person make_person(const std::vector<dna::base>& chromosome)
+{
+	std::array<std::vector<std::byte>, 23> data;
+	for (auto& d : data)
+		d = pack_bases(chromosome);
+	return fake_person(data, 64);
+}
+
+}
+
+TEST_CASE("Anchored positions resolve to the same base in everyone", "[anchor]")
+{
+	const auto body = random_bases(2000, 35);
+	const auto short_telomeres = make_person(concat({telomeres(300), body}));
+	const auto long_telomeres = make_person(concat({telomeres(900, 2), body}));
+
+	const auto position = dna::anchor(short_telomeres, 3, 300 + 1234);
+	CHECK(position == dna::AnchoredPosition{3, 1234});
+
+	auto resolved = dna::resolve(long_telomeres, position);
+	REQUIRE(resolved);
+	CHECK(resolved->base_idx == 900 + 1234);
+	CHECK(resolved->byte == static_cast<long>((900 + 1234) / 4));
+	CHECK(resolved->bit == 2 * (3 - (900 + 1234) % 4));
+
+	// Reading the byte it points at gives back the same base
+	auto helix = long_telomeres.chromosome(3);
+	helix.seek(resolved->byte);
+	const auto byte = helix.read().buffer()[0];
+	CHECK(static_cast<dna::base>((byte >> resolved->bit) & std::byte{0x3}) == body[1234]);
+
+	SECTION("Degraded telomeres can't be anchored")
+	{
+		const auto degraded = make_person(concat({telomeres(4, 2), body}));
+		CHECK_FALSE(dna::resolve(degraded, position));
+		CHECK_FALSE(dna::resolve(long_telomeres, position, 1000));
+		CHECK_THROWS_AS(dna::anchor(degraded, 3, 1000), std::invalid_argument);
+	}
+
+	SECTION("Positions within the telomeres or past the end")
+	{
+		CHECK_THROWS_AS(dna::anchor(short_telomeres, 3, 100), std::invalid_argument);
+		CHECK_FALSE(dna::resolve(short_telomeres, dna::AnchoredPosition{3, 5000}));
+	}
+
+	SECTION("Regions can be given by anchored position")
+	{
+		dna::RegionComparator<> region(long_telomeres, position, 200);
+		CHECK(region.anchoredStart() == position);
+
+		auto result = region.compare(short_telomeres);
+		CHECK(result.status == dna::RegionStatus::Found);
+		CHECK(result.location == dna::Difference::subsection{300 + 1234, 300 + 1434});
+		CHECK(result.differences.empty());
+	}
+}
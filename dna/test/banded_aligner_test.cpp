@@ -0,0 +1,110 @@
+#include "catch.hpp"
+#include "sequence_builder.hpp"
+
+#include <banded_aligner.hpp>
+
+TEST_CASE("Banded global alignment", "[banded]")
+{
+	auto a = random_bases(120, 11);
+	dna::banded_aligner<> aligner;
+
+	SECTION("Identical sequences")
+	{
+		auto score = aligner.global(a, a);
+		REQUIRE(score);
+		CHECK(*score == 2 * 120);
+		REQUIRE(aligner.runs().size() == 1);
+		CHECK(aligner.runs()[0].op == dna::edit_op::match);
+		CHECK(aligner.runs()[0].length == 120);
+	}
+
+	SECTION("Substitution")
+	{
+		auto b = a;
+		b[60] = other(b[60]);
+
+		REQUIRE(aligner.global(a, b));
+		auto runs = aligner.runs();
+		REQUIRE(runs.size() == 3);
+		CHECK(runs[1].op == dna::edit_op::substitution);
+		CHECK(runs[1].a_offset == 60);
+		CHECK(runs[1].b_offset == 60);
+		CHECK(runs[1].length == 1);
+	}
+
+	SECTION("Affine gaps keep a deletion in one run")
+	{
+		auto b = a;
+		b.erase(b.begin() + 40, b.begin() + 45);
+
+		REQUIRE(aligner.global(a, b));
+		auto gaps = std::count_if(aligner.runs().begin(), aligner.runs().end(),
+				[](const dna::edit_run& r) { return r.op != dna::edit_op::match; });
+		CHECK(gaps == 1);
+
+		auto deletion = std::find_if(aligner.runs().begin(), aligner.runs().end(),
+				[](const dna::edit_run& r) { return r.op == dna::edit_op::deletion; });
+		REQUIRE(deletion != aligner.runs().end());
+		CHECK(deletion->length == 5);
+		CHECK(deletion->a_length() == 5);
+		CHECK(deletion->b_length() == 0);
+	}
+
+	SECTION("Length difference wider than the band")
+	{
+		dna::banded_aligner<> narrow(4);
+		CHECK_FALSE(narrow.global(a, dna::base_span(a).first(100)));
+	}
+
+	SECTION("Compile-time scoring scheme")
+	{
+		// Unit costs make the score the negated edit distance
+		constexpr dna::scoring_scheme EDIT_DISTANCE{0, -1, 0, -1};
+		dna::banded_aligner<EDIT_DISTANCE> unit;
+
+		auto b = a;
+		b[10] = other(b[10]);
+		b.erase(b.begin() + 80, b.begin() + 82);
+
+		auto score = unit.global(a, b);
+		REQUIRE(score);
+		CHECK(*score == -3);
+	}
+}
+
+TEST_CASE("Banded aligner resolves small divergent windows", "[banded]")
+{
+	auto a = random_bases(1024, 12);
+	dna::banded_aligner<> aligner;
+
+	SECTION("Clustered substitutions")
+	{
+		auto b = a;
+		b[0] = other(b[0]);
+		b[5] = other(b[5]);
+
+		auto result = aligner.align(a, b);
+		REQUIRE(result);
+		CHECK(result->a_length == 6);
+		CHECK(result->b_length == 6);
+	}
+
+	SECTION("Substitution next to a deletion")
+	{
+		auto b = a;
+		b[0] = other(b[0]);
+		b.erase(b.begin() + 4, b.begin() + 7);
+
+		auto result = aligner.align(a, b);
+		REQUIRE(result);
+		CHECK(result->a_length - result->b_length == 3);
+		CHECK(result->a_length <= 7);
+	}
+
+	SECTION("Divergence longer than the aligned length")
+	{
+		auto b = random_bases(1024, 13);
+		b[0] = other(a[0]);
+		CHECK_FALSE(aligner.align(a, b));
+	}
+}
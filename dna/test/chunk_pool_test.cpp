@@ -0,0 +1,89 @@
+#include "catch.hpp"
+
+#include <atomic>
+#include <thread>
+#include <vector>
+#include <chunk_pool.hpp>
+
+TEST_CASE("Chunk pools lend out aligned chunks and take them back", "[chunk_pool]")
+{
+	dna::chunk_pool pool(100, 3);
+	CHECK(pool.chunk_size() == 128);
+	CHECK(pool.available() == 3);
+
+	auto a = pool.acquire();
+	auto b = pool.acquire();
+	auto c = pool.acquire();
+	REQUIRE(a);
+	REQUIRE(b);
+	REQUIRE(c);
+	CHECK_FALSE(pool.acquire());
+	CHECK(pool.available() == 0);
+	for (const auto* chunk : {&a, &b, &c})
+		CHECK(reinterpret_cast<std::uintptr_t>(chunk->data()) % dna::chunk_pool::CACHE_LINE == 0);
+
+	// Sequence buffers own their chunk, and hand it back when they're done with it
+	b.data()[0] = dna::pack(dna::G, dna::A, dna::T, dna::C);
+	b.resize(1);
+	{
+		dna::pooled_sequence_buffer seq(std::move(b));
+		CHECK_FALSE(b);
+		CHECK(b.size() == 0);
+		CHECK(b.data() == nullptr);
+		CHECK(seq.size() == 4);
+		CHECK(seq[0] == dna::G);
+		CHECK(seq[3] == dna::C);
+		CHECK(pool.available() == 0);
+	}
+	CHECK(pool.available() == 1);
+
+	a.reset();
+	CHECK(pool.available() == 2);
+	auto d = pool.acquire();
+	CHECK(d.size() == pool.chunk_size());
+	CHECK_THROWS_AS(d.resize(pool.chunk_size() + 1), std::invalid_argument);
+
+	// Moving one chunk over another hands the overwritten one back
+	d = std::move(c);
+	CHECK_FALSE(c);
+	CHECK(c.size() == 0);
+	CHECK(c.data() == nullptr);
+	CHECK(pool.available() == 2);
+}
+
+TEST_CASE("Chunk pools can be shared between threads", "[chunk_pool]")
+{
+	constexpr std::size_t threads = 4;
+	dna::chunk_pool pool(64, threads * 2);
+
+	// Each thread stamps the chunks it holds and checks nobody else did in the meantime
+	std::atomic<std::size_t> clashes{0};
+	std::atomic<std::size_t> acquired{0};
+	std::vector<std::thread> workers;
+	for (std::size_t t = 0; t < threads; ++t)
+	{
+		workers.emplace_back([&, t] {
+			const auto stamp = static_cast<std::byte>(t + 1);
+			for (int i = 0; i < 20'000; ++i)
+			{
+				auto first = pool.acquire();
+				auto second = pool.acquire();
+				for (auto* chunk : {&first, &second})
+				{
+					if (!*chunk)
+						continue;
+					++acquired;
+					chunk->data()[0] = stamp;
+					std::this_thread::yield();
+					clashes += chunk->data()[0] != stamp;
+				}
+			}
+		});
+	}
+	for (auto& w : workers)
+		w.join();
+
+	CHECK(clashes == 0);
+	CHECK(acquired == threads * 2 * 20'000);
+	CHECK(pool.available() == pool.count());
+}
@@ -1,5 +1,6 @@
 #include "catch.hpp"
 #include "fake_person.hpp"
+#include "sequence_builder.hpp"
 
 #include "comparator.hpp"
 
@@ -214,3 +215,405 @@ TEST_CASE("getDataRange identifies telomeres")
 		CHECK(end == 30);
 	}
 }
+
+namespace
+{
+
+constexpr std::size_t TELOMERE_LEN = 600;
+
+std::vector<dna::base> with_telomeres(const std::vector<dna::base>& body, std::size_t front = TELOMERE_LEN, std::size_t back = TELOMERE_LEN)
+{
+	return concat({telomeres(front), body, telomeres(back)});
+}
+
+// 23 copies of the same chromosome, with chromosome `modified_idx` replaced
+fake_person make_person(const std::vector<dna::base>& chromosome, std::size_t modified_idx = 0, const std::vector<dna::base>& modified = {}, std::size_t chunk_size = 512)
+{
+	std::array<std::vector<std::byte>, 23> data;
+	for (std::size_t i = 0; i < data.size(); i++)
+		data[i] = pack_bases(i == modified_idx && !modified.empty() ? modified : chromosome);
+	return fake_person(data, chunk_size);
+}
+
+}
+
+TEST_CASE("compare finds differences between people")
+{
+	auto body = random_bases(4000, 42);
+	auto reference = with_telomeres(body);
+	auto person_a = make_person(reference);
+
+	SECTION("Identical people")
+	{
+		CHECK(dna::Comparator::compare(person_a, make_person(reference)).empty());
+	}
+
+	SECTION("Telomere lengths don't matter")
+	{
+		auto person_b = make_person(reference, 3, with_telomeres(body, 300, 1200));
+		CHECK(dna::Comparator::compare(person_a, person_b).empty());
+	}
+
+	SECTION("SNP")
+	{
+		auto snp = body;
+		snp[1000] = snp[1000] == dna::A ? dna::C : dna::A;
+		auto person_b = make_person(reference, 4, with_telomeres(snp));
+
+		auto diffs = dna::Comparator::compare(person_a, person_b);
+		REQUIRE(diffs.size() == 1);
+		CHECK(diffs[0].chromosome_idx == 4);
+		CHECK(diffs[0].person_a == dna::Difference::subsection{TELOMERE_LEN + 1000, TELOMERE_LEN + 1001});
+		CHECK(diffs[0].person_b == dna::Difference::subsection{TELOMERE_LEN + 1000, TELOMERE_LEN + 1001});
+		CHECK(diffs[0].kind == dna::DifferenceKind::Snp);
+		REQUIRE(diffs[0].hasEdit());
+		CHECK(diffs[0].editBase(0) == body[1000]);
+		CHECK(diffs[0].editBase(1) == snp[1000]);
+	}
+
+	SECTION("Short deletion")
+	{
+		auto deleted = body;
+		deleted.erase(deleted.begin() + 2000, deleted.begin() + 2008);
+		auto person_b = make_person(reference, 7, with_telomeres(deleted));
+
+		auto diffs = dna::Comparator::compare(person_a, person_b);
+		REQUIRE(diffs.size() == 1);
+		CHECK(diffs[0].chromosome_idx == 7);
+		auto [a_start, a_end] = diffs[0].person_a;
+		auto [b_start, b_end] = diffs[0].person_b;
+		CHECK(a_end - a_start == 8);
+		CHECK(b_end == b_start);
+		CHECK(diffs[0].kind == dna::DifferenceKind::Deletion);
+		CHECK(diffs[0].edit_length == 8);
+	}
+
+	SECTION("Large insertion with small read chunks")
+	{
+		auto inserted = random_bases(2000, 43);
+		auto longer = body;
+		longer.insert(longer.begin() + 1500, inserted.begin(), inserted.end());
+		auto person_b = make_person(reference, 12, with_telomeres(longer), 16);
+
+		auto diffs = dna::Comparator::compare(person_a, person_b);
+		REQUIRE(diffs.size() == 1);
+		CHECK(diffs[0].chromosome_idx == 12);
+		auto [a_start, a_end] = diffs[0].person_a;
+		auto [b_start, b_end] = diffs[0].person_b;
+		CHECK(a_end == a_start);
+		CHECK(b_end - b_start == 2000);
+		CHECK(diffs[0].kind == dna::DifferenceKind::Insertion);
+		CHECK_FALSE(diffs[0].hasEdit());
+	}
+
+	SECTION("Data lost at the end of one sample")
+	{
+		std::vector<dna::base> truncated(body.begin(), body.end() - 400);
+		auto person_b = make_person(reference, 0, concat({telomeres(TELOMERE_LEN), truncated}));
+
+		auto diffs = dna::Comparator::compare(person_a, person_b);
+		REQUIRE(diffs.size() == 1);
+		CHECK(diffs[0].chromosome_idx == 0);
+		CHECK(diffs[0].person_a.second - diffs[0].person_a.first >= 400);
+		CHECK(diffs[0].person_b.first == diffs[0].person_b.second);
+	}
+
+	SECTION("Every aligner policy agrees on a simple case")
+	{
+		auto snp = body;
+		snp[3000] = snp[3000] == dna::G ? dna::T : dna::G;
+		auto person_b = make_person(reference, 9, with_telomeres(snp));
+
+		auto diffs = dna::Comparator::compare(person_a, person_b, dna::fixed_policy<dna::anchor_aligner>{});
+		REQUIRE(diffs.size() == 1);
+		CHECK(diffs[0].person_a == dna::Difference::subsection{TELOMERE_LEN + 3000, TELOMERE_LEN + 3001});
+	}
+}
+
+TEST_CASE("compare streams differences as they are found")
+{
+	auto body = random_bases(4000, 44);
+	auto reference = with_telomeres(body);
+
+	auto mutated = body;
+	for (std::size_t pos : {500, 1500, 2500})
+		mutated[pos] = mutated[pos] == dna::T ? dna::C : dna::T;
+
+	std::array<std::vector<std::byte>, 23> data;
+	for (auto& chromosome : data)
+		chromosome = pack_bases(with_telomeres(mutated));
+
+	auto person_a = make_person(reference);
+	fake_person person_b(data);
+
+	std::vector<std::pair<std::size_t, std::size_t>> seen;
+	dna::Comparator::compare(person_a, person_b, [&seen](const dna::Difference& d) {
+		seen.emplace_back(d.chromosome_idx, d.person_a.first);
+	});
+
+	// Every autosome has the same three SNPs, reported in order
+	REQUIRE(seen.size() == 22 * 3);
+	CHECK(std::is_sorted(seen.begin(), seen.end()));
+	CHECK(seen[0] == std::pair<std::size_t, std::size_t>{0, TELOMERE_LEN + 500});
+	CHECK(seen.back() == std::pair<std::size_t, std::size_t>{21, TELOMERE_LEN + 2500});
+	CHECK(dna::Comparator::compare(person_a, person_b).size() == seen.size());
+}
+
+TEST_CASE("compare can stop early")
+{
+	auto body = random_bases(4000, 45);
+	auto mutated = body;
+	for (std::size_t pos : {500, 1500, 2500})
+		mutated[pos] = mutated[pos] == dna::T ? dna::C : dna::T;
+
+	auto person_a = make_person(with_telomeres(body));
+	auto person_b = make_person(with_telomeres(body), 2, with_telomeres(mutated));
+
+	SECTION("No limits")
+	{
+		auto result = dna::Comparator::compare(person_a, person_b, dna::CompareOptions{});
+		CHECK(result.status.complete());
+		CHECK(result.status.differences == 3);
+		CHECK(result.differences.size() == 3);
+	}
+
+	SECTION("Maximum number of differences")
+	{
+		dna::CompareOptions options;
+		options.max_differences = 2;
+
+		auto result = dna::Comparator::compare(person_a, person_b, options);
+		CHECK(result.status.reason == dna::StopReason::MaxDifferences);
+		CHECK(result.status.chromosome_idx == 2);
+		CHECK(result.status.person_a_position == TELOMERE_LEN + 2500);
+		CHECK(result.differences.size() == 2);
+	}
+
+	SECTION("Cancellation")
+	{
+		std::stop_source source;
+		source.request_stop();
+
+		dna::CompareOptions options;
+		options.cancellation = source.get_token();
+
+		auto result = dna::Comparator::compare(person_a, person_b, options);
+		CHECK(result.status.reason == dna::StopReason::Cancelled);
+		CHECK(result.status.chromosome_idx == 0);
+		CHECK(result.differences.empty());
+	}
+
+	SECTION("Deadline")
+	{
+		dna::CompareOptions options;
+		options.deadline = std::chrono::steady_clock::now();
+
+		auto result = dna::Comparator::compare(person_a, person_b, options);
+		CHECK(result.status.reason == dna::StopReason::Deadline);
+		CHECK_FALSE(result.status.complete());
+	}
+}
+
+TEST_CASE("compare moves on when the alignment policy gives up")
+{
+	struct giving_up_policy
+	{
+		dna::alignment resolve(dna::base_span, dna::base_span) const
+		{
+			return {0, 0};
+		}
+	};
+
+	auto body = random_bases(4000, 48);
+	auto mutated = body;
+	for (std::size_t pos : {500, 1500})
+		mutated[pos] = mutated[pos] == dna::T ? dna::C : dna::T;
+
+	dna::span_cursor cursor_a(body);
+	dna::span_cursor cursor_b(mutated);
+	std::vector<dna::Difference> found;
+	auto status = dna::Comparator::compareRange(0, cursor_a, cursor_b,
+			[&found](const dna::Difference& d) { found.push_back(d); }, dna::CompareOptions{}, giving_up_policy{});
+
+	CHECK(status.complete());
+	REQUIRE(found.size() == 2);
+	CHECK(found[0].person_a == std::pair<std::size_t, std::size_t>{500, 501});
+	CHECK(found[1].person_b == std::pair<std::size_t, std::size_t>{1500, 1501});
+}
+
+TEST_CASE("compare completes when it finds exactly the maximum number of differences")
+{
+	auto body = random_bases(4000, 47);
+	auto mutated = body;
+
+	dna::CompareOptions options;
+	options.max_differences = 3;
+
+	auto compare = [&] {
+		dna::span_cursor cursor_a(body);
+		dna::span_cursor cursor_b(mutated);
+		std::size_t seen = 0;
+		auto status = dna::Comparator::compareRange(0, cursor_a, cursor_b, [&seen](const dna::Difference&) { ++seen; }, options);
+		CHECK(status.differences == seen);
+		return status;
+	};
+
+	SECTION("Followed by identical bases")
+	{
+		for (std::size_t pos : {500, 1500, 2500})
+			mutated[pos] = mutated[pos] == dna::T ? dna::C : dna::T;
+
+		auto status = compare();
+		CHECK(status.complete());
+		CHECK(status.differences == 3);
+		CHECK(status.person_a_position == body.size());
+	}
+
+	SECTION("Ending at the last base")
+	{
+		for (std::size_t pos : {500, 1500, 3999})
+			mutated[pos] = mutated[pos] == dna::T ? dna::C : dna::T;
+
+		auto status = compare();
+		CHECK(status.complete());
+		CHECK(status.differences == 3);
+	}
+
+	SECTION("More found, but merged or dropped")
+	{
+		// 500 and 540 merge into one region; the lone SNPs after it are too short to report
+		for (std::size_t pos : {500, 540, 2500, 3500})
+			mutated[pos] = mutated[pos] == dna::T ? dna::C : dna::T;
+		options.max_differences = 1;
+		options.merge_gap = 50;
+		options.min_length = 5;
+
+		auto status = compare();
+		CHECK(status.complete());
+		CHECK(status.differences == 1);
+	}
+
+	SECTION("One more than the maximum")
+	{
+		for (std::size_t pos : {500, 1500, 2500, 3500})
+			mutated[pos] = mutated[pos] == dna::T ? dna::C : dna::T;
+
+		auto status = compare();
+		CHECK(status.reason == dna::StopReason::MaxDifferences);
+		CHECK(status.differences == 3);
+		CHECK(status.person_a_position == 3500);
+	}
+}
+
+TEST_CASE("compare merges and filters differences while scanning")
+{
+	auto body = random_bases(4000, 46);
+	auto mutated = body;
+	for (std::size_t pos : {500, 540, 2500})
+		mutated[pos] = mutated[pos] == dna::A ? dna::G : dna::A;
+
+	auto person_a = make_person(with_telomeres(body));
+	auto person_b = make_person(with_telomeres(body), 6, with_telomeres(mutated));
+
+	dna::CompareOptions options;
+
+	SECTION("Nearby differences are merged")
+	{
+		options.merge_gap = 50;
+
+		auto diffs = dna::Comparator::compare(person_a, person_b, options).differences;
+		REQUIRE(diffs.size() == 2);
+		CHECK(diffs[0].person_a == dna::Difference::subsection{TELOMERE_LEN + 500, TELOMERE_LEN + 541});
+		CHECK(diffs[0].kind == dna::DifferenceKind::Complex);
+		CHECK(diffs[1].person_a == dna::Difference::subsection{TELOMERE_LEN + 2500, TELOMERE_LEN + 2501});
+	}
+
+	SECTION("Short regions are dropped")
+	{
+		options.merge_gap = 50;
+		options.min_length = 5;
+
+		auto diffs = dna::Comparator::compare(person_a, person_b, options).differences;
+		REQUIRE(diffs.size() == 1);
+		CHECK(diffs[0].person_b == dna::Difference::subsection{TELOMERE_LEN + 500, TELOMERE_LEN + 541});
+	}
+
+	SECTION("Low scoring regions are dropped")
+	{
+		options.min_score = 2;
+		CHECK(dna::Comparator::compare(person_a, person_b, options).differences.empty());
+
+		options.merge_gap = 50;
+		CHECK(dna::Comparator::compare(person_a, person_b, options).differences.size() == 1);
+	}
+}
+
+TEST_CASE("ComparisonContext is reused between comparisons")
+{
+	auto body = random_bases(20000, 48);
+	auto snp = body;
+	snp[7000] = snp[7000] == dna::A ? dna::T : dna::A;
+
+	auto person_a = make_person(with_telomeres(body), 0, {}, 64);
+	auto person_b = make_person(with_telomeres(body), 6, with_telomeres(snp), 64);
+
+	dna::ComparisonContext<> context;
+	auto first = context.compare(person_a, person_b);
+	const auto capacity = context.scratch().capacity();
+	CHECK(capacity > 0);
+
+	// Once warm, the scratch arena holds everything a comparison of this size needs
+	for (int i = 0; i < 3; ++i)
+	{
+		CHECK(context.compare(person_a, person_b) == first);
+		CHECK(context.scratch().capacity() == capacity);
+	}
+
+	REQUIRE(first.size() == 1);
+	CHECK(first[0].chromosome_idx == 6);
+	CHECK(dna::Comparator::compare(person_a, person_b) == first);
+}
+
+TEST_CASE("compare reports what it did")
+{
+	auto body = random_bases(4000, 49);
+	auto snp = body;
+	snp[1500] = snp[1500] == dna::A ? dna::G : dna::A;
+
+	auto person_a = make_person(with_telomeres(body), 4, with_telomeres(snp));
+	auto person_b = make_person(with_telomeres(body), 3, with_telomeres(body, 300, 1200));
+
+	dna::ComparisonContext<> context;
+	const auto result = context.compare(person_a, person_b, {});
+	const auto& stats = result.stats;
+	REQUIRE(result.differences.size() == 1);
+
+	// The sex chromosomes are too short to tell apart, so they aren't compared
+	CHECK(stats.chromosomes == 22);
+	CHECK(stats.bases_scanned == 22 * body.size());
+	CHECK(stats.identical_bases == stats.bases_scanned - 1);
+	CHECK(stats.identicalFraction() > 0.99);
+	CHECK(stats.windows == 1);
+	CHECK(stats.aligned.snp == 1);
+	CHECK(stats.aligned.total() == 1);
+
+	// Both people are read in full, a chunk at a time
+	CHECK(stats.bytes_read >= 2 * stats.bases_scanned / dna::packed_size::value);
+	CHECK(stats.reads >= stats.bytes_read / 512);
+
+	REQUIRE(stats.telomeres.size() == 22);
+	REQUIRE(stats.telomeres[3]);
+	CHECK(stats.telomeres[3]->person_a == dna::TelomereLengths{TELOMERE_LEN, TELOMERE_LEN});
+	CHECK(stats.telomeres[3]->person_b == dna::TelomereLengths{300, 1200});
+
+	// The context keeps a running total, for combining with other threads' at the end
+	context.compare(person_a, person_b, {});
+	CHECK(context.stats().chromosomes == 44);
+	CHECK(context.stats().windows == 2);
+
+	dna::ComparisonStats total{};
+	total += context.stats();
+	total += dna::Comparator::compare(person_a, person_b, {}).stats;
+	CHECK(total.chromosomes == 66);
+	CHECK(total.telomeres == stats.telomeres);
+}
@@ -0,0 +1,110 @@
+#include "catch.hpp"
+
+#include <difference_codec.hpp>
+
+namespace
+{
+
+dna::Difference snp(std::size_t chromosome, std::size_t a_pos, std::size_t b_pos, dna::base from, dna::base to)
+{
+	dna::Difference d(chromosome, a_pos, a_pos + 1, b_pos, b_pos + 1);
+	std::vector<dna::base> a{from};
+	std::vector<dna::base> b{to};
+	d.setEdit(a, b);
+	return d;
+}
+
+}
+
+TEST_CASE("Differences are typed", "[codec]")
+{
+	CHECK(dna::Difference(0, 10, 11, 10, 11).kind == dna::DifferenceKind::Snp);
+	CHECK(dna::Difference(0, 10, 10, 10, 14).kind == dna::DifferenceKind::Insertion);
+	CHECK(dna::Difference(0, 10, 14, 10, 10).kind == dna::DifferenceKind::Deletion);
+	CHECK(dna::Difference(0, 10, 12, 10, 15).kind == dna::DifferenceKind::Complex);
+
+	auto d = snp(0, 10, 10, dna::C, dna::T);
+	REQUIRE(d.hasEdit());
+	CHECK(d.editBase(0) == dna::C);
+	CHECK(d.editBase(1) == dna::T);
+}
+
+TEST_CASE("Differences round trip through the compact encoding", "[codec]")
+{
+	std::vector<dna::Difference> diffs{
+		snp(0, 1000, 1000, dna::A, dna::G),
+		snp(0, 2000, 2000, dna::T, dna::C),
+		dna::Difference(0, 3000, 3004, 3000, 3000),
+		dna::Difference(0, 5000, 5000, 4996, 5100),
+		dna::Difference(3, 12, 80, 40, 41),
+		snp(22, 7, 9, dna::G, dna::A),
+	};
+
+	std::vector<dna::base> deleted{dna::A, dna::C, dna::G, dna::T};
+	diffs[2].setEdit(deleted, {});
+
+	diffs[4].makeComplex();
+
+	auto encoded = dna::encodeDifferences(diffs);
+	CHECK(dna::decodeDifferences(encoded) == diffs);
+}
+
+TEST_CASE("The compact encoding is small", "[codec]")
+{
+	std::vector<std::byte> encoded;
+	dna::DifferenceEncoder encoder(encoded);
+
+	// SNPs about a thousand bases apart, as between two people
+	for (std::size_t i = 1; i <= 1000; ++i)
+		encoder(snp(i / 100, i * 1000, i * 1000, dna::A, dna::C));
+
+	// Tag, two bytes of position delta and a zero offset change
+	CHECK(encoded.size() < 5 * 1000);
+	CHECK(dna::decodeDifferences(encoded).size() == 1000);
+}
+
+TEST_CASE("Truncated encodings are rejected", "[codec]")
+{
+	auto encoded = dna::encodeDifferences(std::vector<dna::Difference>{dna::Difference(1, 300, 400, 300, 310)});
+	encoded.pop_back();
+
+	CHECK_THROWS_AS(dna::decodeDifferences(encoded), std::invalid_argument);
+}
+
+TEST_CASE("Edits longer than a Difference can hold are rejected", "[codec]")
+{
+	// A complex difference of 20 + 20 bases claiming an edit, which no encoder writes
+	std::vector<std::byte> encoded{
+		std::byte{static_cast<std::uint8_t>(dna::DifferenceKind::Complex) | 0x04 | 0x08},
+		std::byte{0}, // chromosome
+		std::byte{0}, // a start
+		std::byte{0}, // b offset
+		std::byte{20}, // a length
+		std::byte{20}, // b length
+	};
+	encoded.resize(encoded.size() + 10, std::byte{0});
+
+	CHECK_THROWS_AS(dna::decodeDifferences(encoded), std::invalid_argument);
+}
+
+TEST_CASE("Differences running past the address space are rejected", "[codec]")
+{
+	// a starts at 2^63 - 1 and is 2^63 + 1 bases long
+	std::vector<std::byte> encoded{
+		std::byte{static_cast<std::uint8_t>(dna::DifferenceKind::Deletion) | 0x08},
+		std::byte{0},
+	};
+	const auto put = [&](std::uint64_t value) {
+		while (value >= 0x80)
+		{
+			encoded.push_back(static_cast<std::byte>(value | 0x80));
+			value >>= 7;
+		}
+		encoded.push_back(static_cast<std::byte>(value));
+	};
+	put(UINT64_MAX - 1); // zigzag of 2^63 - 1
+	put(0);
+	put((std::uint64_t{1} << 63) + 1);
+
+	CHECK_THROWS_AS(dna::decodeDifferences(encoded), std::invalid_argument);
+}
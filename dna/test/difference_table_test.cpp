@@ -0,0 +1,71 @@
+#include "catch.hpp"
+#include "fake_person.hpp"
+#include "sequence_builder.hpp"
+
+#include <comparator.hpp>
+#include <difference_table.hpp>
+
+TEST_CASE("DifferenceTable stores differences by column", "[table]")
+{
+	std::vector<dna::Difference> diffs{
+		dna::Difference(0, 100, 101, 100, 101),
+		dna::Difference(0, 200, 200, 200, 250),
+		dna::Difference(1, 150, 180, 150, 150),
+		dna::Difference(0, 400, 420, 450, 460),
+	};
+
+	dna::DifferenceTable table;
+	table.append(diffs);
+
+	REQUIRE(table.size() == 4);
+	CHECK(table.chromosomes()[2] == 1);
+	CHECK(table.starts(dna::Sample::B)[3] == 450);
+	CHECK(table.row(1) == diffs[1]);
+
+	SECTION("Overlap queries")
+	{
+		CHECK(table.overlapping(0, 0, 1000) == dna::DifferenceTable::Selection{0, 1, 3});
+		CHECK(table.overlapping(0, 101, 200).empty());
+		CHECK(table.overlapping(1, 100, 160) == dna::DifferenceTable::Selection{2});
+		CHECK(table.overlapping(0, 440, 455, dna::Sample::B) == dna::DifferenceTable::Selection{3});
+	}
+
+	SECTION("Insertions cover the position they were inserted at")
+	{
+		CHECK(table.overlapping(0, 200, 201) == dna::DifferenceTable::Selection{1});
+		CHECK(table.overlapping(0, 199, 200).empty());
+	}
+
+	SECTION("Kind queries")
+	{
+		CHECK(table.ofKind(dna::DifferenceKind::Snp) == dna::DifferenceTable::Selection{0});
+		CHECK(table.ofKind(dna::DifferenceKind::Deletion) == dna::DifferenceTable::Selection{2});
+
+		dna::DifferenceTable without_kinds(false);
+		without_kinds.append(diffs);
+		CHECK_THROWS_AS(without_kinds.ofKind(dna::DifferenceKind::Snp), std::logic_error);
+	}
+}
+
+TEST_CASE("compare writes directly into a DifferenceTable", "[table]")
+{
+	auto body = random_bases(2000, 47);
+	auto mutated = body;
+	mutated[700] = mutated[700] == dna::C ? dna::G : dna::C;
+
+	std::array<std::vector<std::byte>, 23> data_a;
+	std::array<std::vector<std::byte>, 23> data_b;
+	for (std::size_t i = 0; i < data_a.size(); ++i)
+	{
+		data_a[i] = pack_bases(body);
+		data_b[i] = pack_bases(i == 5 ? mutated : body);
+	}
+
+	dna::DifferenceTable table;
+	dna::Comparator::compare(fake_person(data_a), fake_person(data_b), table);
+
+	REQUIRE(table.size() == 1);
+	CHECK(table.chromosomes()[0] == 5);
+	CHECK(table.kinds()[0] == dna::DifferenceKind::Snp);
+	CHECK(table.overlapping(5, 700, 701).size() == 1);
+}
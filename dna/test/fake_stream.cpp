@@ -1,7 +1,20 @@
 #include "fake_stream.hpp"
 
+#include <utility>
+
+namespace
+{
+
+const std::shared_ptr<const std::vector<std::byte>>& empty_data()
+{
+	static const auto empty = std::make_shared<const std::vector<std::byte>>();
+	return empty;
+}
+
+}
+
 fake_stream::fake_stream() :
-		data_(0),
+		data_(empty_data()),
 		chunksize_(1),
 		offset_(0)
 { }
@@ -13,13 +26,13 @@ fake_stream::fake_stream(const fake_stream& other) :
 { }
 
 fake_stream::fake_stream(fake_stream&& other) noexcept :
-		data_(std::move(other.data_)),
+		data_(std::exchange(other.data_, empty_data())),
 		chunksize_(other.chunksize_),
 		offset_(other.offset_.exchange(0))
 { }
 
 fake_stream::fake_stream(std::vector<std::byte> data, std::size_t chunksize) :
-		data_(std::move(data)),
+		data_(std::make_shared<const std::vector<std::byte>>(std::move(data))),
 		chunksize_(chunksize),
 		offset_(0)
 { }
@@ -36,7 +49,7 @@ fake_stream& fake_stream::operator=(const fake_stream& other)
 fake_stream& fake_stream::operator=(fake_stream&& other) noexcept
 {
 	chunksize_ = other.chunksize_;
-	data_ = std::move(other.data_);
+	data_ = std::exchange(other.data_, empty_data());
 	offset_ = other.offset_.exchange(0);
 
 	return *this;
@@ -44,12 +57,12 @@ fake_stream& fake_stream::operator=(fake_stream&& other) noexcept
 
 void fake_stream::seek(long offset)
 {
-	offset_.store(std::min(std::max(offset, 0L), static_cast<long>(data_.size())));
+	offset_.store(std::min(std::max(offset, 0L), static_cast<long>(data_->size())));
 }
 
 long fake_stream::size() const
 {
-	return data_.size();
+	return data_->size();
 }
 
 dna::sequence_buffer<fake_stream::byte_view> fake_stream::read()
@@ -57,11 +70,11 @@ dna::sequence_buffer<fake_stream::byte_view> fake_stream::read()
 	auto offset = offset_.load(std::memory_order_consume);
 	while (true)
 	{
-		auto len = std::min(chunksize_, data_.size() - offset_);
+		auto len = std::min(chunksize_, data_->size() - offset_);
 		if (len == 0)
 			return byte_view(nullptr, 0);
 
 		if (offset_.compare_exchange_weak(offset, offset + len, std::memory_order_release))
-			return byte_view(data_.data() + offset, len);
+			return byte_view(data_->data() + offset, len);
 	}
 }
@@ -1,6 +1,7 @@
 #pragma once
 
 #include <cstddef>
+#include <memory>
 #include <string_view>
 #include <vector>
 #include <atomic>
@@ -25,9 +26,11 @@ public:
 
 }
 
+// Copies share the same (immutable) data and only keep their own read position,
+// so handing out a copy of a chromosome is cheap
 class fake_stream
 {
-	std::vector<std::byte> data_;
+	std::shared_ptr<const std::vector<std::byte>> data_;
 	std::size_t chunksize_;
 	std::atomic<long> offset_;
 public:
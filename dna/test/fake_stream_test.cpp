@@ -120,6 +120,27 @@ TEST_CASE("Fake stream is suitable for testing", "[stream]")
 	REQUIRE(endseq[7] == dna::C);
 }
 
+TEST_CASE("Fake stream copies share their data", "[stream]")
+{
+	fake_stream stream(fake_data(), 128);
+	stream.seek(100);
+
+	fake_stream copy = stream;
+	REQUIRE(copy.size() == stream.size());
+
+	// Same bytes, but each copy reads from its own position
+	auto original_seq = stream.read();
+	auto copied_seq = copy.read();
+	REQUIRE(copied_seq.buffer().data() == original_seq.buffer().data());
+
+	copy.seek(0);
+	REQUIRE(copy.read().buffer().data() != stream.read().buffer().data());
+
+	fake_stream moved = std::move(copy);
+	REQUIRE(moved.size() == stream.size());
+	REQUIRE(copy.size() == 0);
+}
+
 TEST_CASE("Fake person fulfills Person concept", "[stream]")
 {
 	fake_person person(std::array<std::vector<std::byte>, 23> {
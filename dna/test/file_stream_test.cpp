@@ -0,0 +1,100 @@
+#include "catch.hpp"
+#include "procedural_stream.hpp"
+#include "temporary_file.hpp"
+
+#include <filesystem>
+#include <system_error>
+#include <thread>
+#include <vector>
+#include <file_stream.hpp>
+
+namespace
+{
+
+std::vector<std::byte> read_all(dna::file_stream& helix)
+{
+	std::vector<std::byte> bytes;
+	for (auto seq = helix.read(); seq.size() > 0; seq = helix.read())
+		bytes.insert(bytes.end(), seq.buffer().begin(), seq.buffer().end());
+	return bytes;
+}
+
+}
+
+TEST_CASE("File streams read packed chromosomes from disk", "[file_stream]")
+{
+	const procedural_stream source(11, 21, 400'000, 19);
+	std::vector<std::byte> expected(static_cast<std::size_t>(source.size()));
+	source.read_at(0, expected);
+	const temporary_file file(expected);
+
+	const auto io = GENERATE(dna::file_stream::backend::automatic, dna::file_stream::backend::pread);
+	dna::file_stream helix(file.path(), 0, -1, 4096, 4, io);
+	REQUIRE(helix.size() == static_cast<long>(expected.size()));
+	CHECK(read_all(helix) == expected);
+	if (io == dna::file_stream::backend::pread)
+		CHECK_FALSE(helix.uses_io_uring());
+
+	// Seeking starts over from anywhere, including part way through a chunk
+	helix.seek(5000);
+	auto seq = helix.read();
+	REQUIRE(seq.size() == 4096 * dna::packed_size::value);
+	CHECK(std::equal(seq.buffer().begin(), seq.buffer().end(), expected.begin() + 5000));
+	helix.seek(static_cast<long>(expected.size()) - 10);
+	CHECK(helix.read().size() == 10 * dna::packed_size::value);
+	CHECK(helix.read().size() == 0);
+
+	// Copies carry on from the same place
+	helix.seek(100);
+	dna::file_stream copy(helix);
+	CHECK(copy.read().buffer()[0] == expected[100]);
+
+	// A byte range of the file is a chromosome of its own
+	dna::file_stream shard(file.path(), 1000, 50'000, 4096, 4, io);
+	CHECK(read_all(shard) == std::vector<std::byte>(expected.begin() + 1000, expected.begin() + 51'000));
+}
+
+TEST_CASE("File streams can be read at many positions at once", "[file_stream]")
+{
+	const procedural_stream source(12, 21, 400'000, 19);
+	std::vector<std::byte> expected(static_cast<std::size_t>(source.size()));
+	source.read_at(0, expected);
+	const temporary_file file(expected);
+	const dna::file_stream helix(file.path());
+
+	std::vector<std::byte> bytes(expected.size());
+	std::vector<std::thread> threads;
+	const std::size_t shard = bytes.size() / 4 + 1;
+	for (std::size_t i = 0; i < 4; ++i)
+	{
+		threads.emplace_back([&, i] {
+			const auto offset = std::min(i * shard, bytes.size());
+			helix.read_at(static_cast<long>(offset), std::span(bytes).subspan(offset, std::min(shard, bytes.size() - offset)));
+		});
+	}
+	for (auto& t : threads)
+		t.join();
+	CHECK(bytes == expected);
+
+	std::vector<std::byte> past_end(100);
+	CHECK(helix.read_at(static_cast<long>(expected.size()) - 10, past_end) == 10);
+
+	CHECK_THROWS_AS(dna::file_stream("/nonexistent/chromosome"), std::system_error);
+	CHECK_THROWS_AS(dna::file_stream(file.path(), 10, static_cast<long>(expected.size())), std::invalid_argument);
+}
+
+TEST_CASE("File streams report failed reads and carry on", "[file_stream]")
+{
+	// A directory opens and has a size, but reading it fails (EISDIR)
+	const auto io = GENERATE(dna::file_stream::backend::automatic, dna::file_stream::backend::pread);
+	dna::file_stream helix(std::filesystem::temp_directory_path().string(), 0, -1, 512, 4, io);
+	if (helix.size() == 0)
+		return;
+
+	// Every chunk in flight fails, and each read() reports it instead of waiting on one
+	// that never completes
+	CHECK_THROWS_AS(helix.read(), std::system_error);
+	CHECK_THROWS_AS(helix.read(), std::system_error);
+	helix.seek(helix.size() / 2);
+	CHECK_THROWS_AS(helix.read(), std::system_error);
+}
@@ -0,0 +1,74 @@
+#include "catch.hpp"
+
+#include <cstring>
+#include <vector>
+#include <alignment_policy.hpp>
+#include <chunk_pool.hpp>
+#include <huge_page_resource.hpp>
+#include <interval_index.hpp>
+#include "sequence_builder.hpp"
+
+TEST_CASE("Huge page memory is mapped for large allocations only", "[huge_page_resource]")
+{
+	using dna::huge_page_resource;
+	huge_page_resource resource;
+	const auto& counts = resource.allocations();
+
+	// Whichever kind of page backs it, a large allocation is huge page aligned and usable
+	const std::size_t bytes = 3 * huge_page_resource::HUGE_PAGE + 12345;
+	void* p = resource.allocate(bytes, 64);
+	CHECK(reinterpret_cast<std::uintptr_t>(p) % huge_page_resource::HUGE_PAGE == 0);
+	std::memset(p, 0xAB, bytes);
+	CHECK(static_cast<unsigned char*>(p)[bytes - 1] == 0xAB);
+	resource.deallocate(p, bytes, 64);
+	CHECK(counts.reserved + counts.transparent + counts.small_pages == 1);
+	CHECK(counts.upstream == 0);
+
+	// Small ones aren't worth it
+	std::pmr::vector<int> small({1, 2, 3}, &resource);
+	CHECK(counts.upstream == 1);
+
+	// Without the reserved pool, huge pages come from madvise() if they come at all
+	huge_page_resource transparent(huge_page_resource::HUGE_PAGE / 2, false);
+	dna::chunk_pool pool(1 << 16, 64, &transparent);
+	auto chunk = pool.acquire();
+	chunk.data()[chunk.size() - 1] = std::byte{1};
+	CHECK(transparent.allocations().reserved == 0);
+	CHECK(transparent.allocations().transparent + transparent.allocations().small_pages == 1);
+}
+
+TEST_CASE("Indexes, tables and owned chromosomes can live on huge pages", "[huge_page_resource]")
+{
+	// Every allocation gets a mapping of its own, so each one shows up in the counts
+	dna::huge_page_resource resource(0);
+	const auto& counts = resource.allocations();
+	const auto mapped = [&] { return counts.reserved + counts.transparent + counts.small_pages; };
+
+	std::vector<dna::Difference> differences{dna::Difference(0, 10, 20, 10, 20), dna::Difference(1, 5, 6, 5, 6)};
+	dna::DifferenceTable table(true, &resource);
+	table.append(differences);
+	CHECK(mapped() > 0);
+
+	auto before = mapped();
+	const auto index = dna::IntervalIndex::build(table, dna::Sample::A, &resource);
+	CHECK(mapped() > before);
+	CHECK(index.overlapping(0, 15, 16) == std::vector<std::uint32_t>{0});
+
+	// The fallback aligner's k-mer tables
+	before = mapped();
+	dna::adaptive_policy<> policy(&resource);
+	const auto a = random_bases(2000, 3);
+	auto b = random_bases(300, 4);
+	b.insert(b.end(), a.begin(), a.end());
+	const auto resolved = policy.resolve(a, b);
+	CHECK(resolved.a_length == 0);
+	CHECK(resolved.b_length == 300);
+	CHECK(mapped() > before);
+
+	// A sequence_buffer owns whatever ByteBuffer it's given, pmr vectors included
+	before = mapped();
+	std::pmr::vector<std::byte> bytes({dna::pack(dna::G, dna::A, dna::T, dna::C)}, &resource);
+	dna::sequence_buffer<std::pmr::vector<std::byte>> chromosome(std::move(bytes));
+	CHECK(chromosome[2] == dna::T);
+	CHECK(mapped() > before);
+}
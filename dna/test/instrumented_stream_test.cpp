@@ -0,0 +1,97 @@
+#include "catch.hpp"
+#include "procedural_stream.hpp"
+
+#include <thread>
+#include <vector>
+#include <comparator.hpp>
+#include <instrumented_stream.hpp>
+
+TEST_CASE("Latency histogram buckets are log-linear", "[instrumented_stream]")
+{
+	using histogram = dna::latency_histogram;
+
+	// Small values are exact, and every bucket picks up where the last left off
+	for (std::uint64_t v = 0; v < histogram::SUB_BUCKETS; ++v)
+		CHECK(histogram::bucket(v) == v);
+
+	std::size_t gaps = 0;
+	std::size_t misplaced = 0;
+	for (std::size_t b = 1; b + 1 < histogram::BUCKETS; ++b)
+	{
+		gaps += histogram::lowest(b) != histogram::highest(b - 1) + 1;
+		misplaced += histogram::bucket(histogram::lowest(b)) != b || histogram::bucket(histogram::highest(b)) != b;
+	}
+	CHECK(gaps == 0);
+	CHECK(misplaced == 0);
+	CHECK(histogram::bucket(UINT64_MAX) == histogram::BUCKETS - 1);
+	CHECK(histogram::highest(histogram::BUCKETS - 1) == UINT64_MAX);
+
+	// Each bucket is no wider than 1/SUB_BUCKETS of the values in it
+	const auto b = histogram::bucket(1'000'000);
+	CHECK(histogram::highest(b) - histogram::lowest(b) + 1 <= 1'000'000 / histogram::SUB_BUCKETS);
+
+	histogram h;
+	for (std::uint64_t v = 1; v <= 1000; ++v)
+		h.record(v);
+	CHECK(h.count() == 1000);
+	CHECK(h.max() == 1000);
+	CHECK(h.mean() == Approx(500.5));
+	CHECK(h.percentile(0.5) >= 500);
+	CHECK(h.percentile(0.5) <= 500 + 500 / histogram::SUB_BUCKETS);
+	CHECK(h.percentile(1.0) == 1000);
+
+	histogram other;
+	other.record(5000);
+	h.merge(other);
+	CHECK(h.count() == 1001);
+	CHECK(h.max() == 5000);
+}
+
+TEST_CASE("Instrumented streams record every read and seek", "[instrumented_stream]")
+{
+	static_assert(dna::HelixStream<dna::instrumented_stream<procedural_stream>>);
+	static_assert(dna::Person<dna::instrumented_person<procedural_person>>);
+
+	const procedural_person person(1, 1, procedural_person::sex::x, 1e-3, 4096);
+	auto metrics_ptr = std::make_shared<dna::stream_metrics>();
+	const dna::instrumented_person instrumented(person, metrics_ptr);
+	const auto& metrics = *metrics_ptr;
+
+	auto helix = instrumented.chromosome(0);
+	std::size_t reads = 0;
+	for (auto seq = helix.read(); seq.size() > 0; seq = helix.read())
+		++reads;
+	helix.seek(0);
+
+	CHECK(metrics.reads == reads + 1);
+	CHECK(metrics.seeks == 1);
+	CHECK(metrics.bytes_read == static_cast<std::size_t>(person.chromosome(0).size()));
+	CHECK(metrics.read_latency.count() == reads + 1);
+	CHECK(metrics.seek_latency.count() == 1);
+
+	// Threads reading different chromosomes all add up in the same metrics
+	metrics_ptr->reset();
+	std::vector<std::thread> threads;
+	for (std::size_t i = 0; i < 4; ++i)
+	{
+		threads.emplace_back([&, i] {
+			auto h = instrumented.chromosome(i);
+			for (auto seq = h.read(); seq.size() > 0; seq = h.read())
+			{ }
+		});
+	}
+	for (auto& t : threads)
+		t.join();
+
+	std::uint64_t bytes = 0;
+	for (std::size_t i = 0; i < 4; ++i)
+		bytes += static_cast<std::uint64_t>(person.chromosome(i).size());
+	CHECK(metrics.bytes_read == bytes);
+	CHECK(metrics.read_latency.count() == metrics.reads);
+
+	// And they drop straight into a comparison
+	metrics_ptr->reset();
+	const auto differences = dna::Comparator::compare(instrumented, person);
+	CHECK(differences == dna::Comparator::compare(person, person));
+	CHECK(metrics.reads > 0);
+}
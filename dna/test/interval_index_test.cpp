@@ -0,0 +1,131 @@
+#include "catch.hpp"
+
+#include <difference_table.hpp>
+#include <interval_index.hpp>
+
+#include <algorithm>
+#include <cstring>
+#include <random>
+
+namespace
+{
+	// What DifferenceTable::overlapping would return, for checking the index against
+	std::vector<std::uint32_t> brute_force(const std::vector<dna::Difference>& diffs, size_t chromosome_idx, size_t start, size_t end)
+	{
+		dna::DifferenceTable table;
+		table.append(diffs);
+		return table.overlapping(chromosome_idx, start, end);
+	}
+
+	std::vector<std::uint32_t> sorted(std::vector<std::uint32_t> ids)
+	{
+		std::sort(ids.begin(), ids.end());
+		return ids;
+	}
+}
+
+TEST_CASE("IntervalIndex answers overlap queries", "[index]")
+{
+	std::vector<dna::Difference> diffs{
+		dna::Difference(0, 400, 420, 450, 460),
+		dna::Difference(0, 100, 101, 100, 101),
+		dna::Difference(0, 200, 200, 200, 250),
+		dna::Difference(2, 150, 180, 150, 150),
+		dna::Difference(0, 50, 1000, 50, 1000),
+	};
+
+	const auto index = dna::IntervalIndex::build(diffs);
+
+	CHECK(index.view().size() == diffs.size());
+	CHECK(sorted(index.overlapping(0, 0, 60)) == std::vector<std::uint32_t>{4});
+	CHECK(sorted(index.overlapping(0, 101, 200)) == std::vector<std::uint32_t>{4});
+	CHECK(sorted(index.overlapping(0, 200, 201)) == std::vector<std::uint32_t>{2, 4});
+	CHECK(sorted(index.overlapping(0, 0, 2000)) == std::vector<std::uint32_t>{0, 1, 2, 4});
+	CHECK(index.overlapping(2, 150, 151) == std::vector<std::uint32_t>{3});
+	CHECK(index.overlapping(1, 0, 2000).empty());
+	CHECK(index.overlapping(5, 0, 2000).empty());
+
+	const auto by_b = dna::IntervalIndex::build(diffs, dna::Sample::B);
+	CHECK(by_b.view().sample() == dna::Sample::B);
+	CHECK(sorted(by_b.overlapping(0, 440, 455)) == std::vector<std::uint32_t>{0, 4});
+	CHECK(by_b.overlapping(2, 150, 151) == std::vector<std::uint32_t>{3});
+}
+
+TEST_CASE("IntervalIndex matches a linear scan", "[index]")
+{
+	std::mt19937_64 rng(33);
+	std::uniform_int_distribution<size_t> position(0, 100000);
+	std::uniform_int_distribution<size_t> length(0, 2000);
+	std::uniform_int_distribution<size_t> chromosome(0, 3);
+
+	// Sizes around powers of two exercise the implicit tree's missing right children
+	for (size_t n : {1, 7, 8, 9, 255, 256, 1000, 4097})
+	{
+		std::vector<dna::Difference> diffs;
+		for (size_t i = 0; i < n; ++i)
+		{
+			const size_t start = position(rng);
+			const size_t end = start + length(rng);
+			diffs.emplace_back(chromosome(rng), start, end, start, end);
+		}
+
+		dna::DifferenceTable table;
+		table.append(diffs);
+		const auto index = dna::IntervalIndex::build(table);
+
+		for (int q = 0; q < 50; ++q)
+		{
+			const size_t c = chromosome(rng);
+			const size_t start = position(rng);
+			const size_t end = start + 1 + length(rng);
+			CHECK(sorted(index.overlapping(c, start, end)) == table.overlapping(c, start, end));
+		}
+	}
+}
+
+TEST_CASE("IntervalIndex can be queried from its serialized bytes", "[index]")
+{
+	std::vector<dna::Difference> diffs;
+	for (size_t i = 0; i < 300; ++i)
+	{
+		diffs.emplace_back(i % 3, 10 * i, 10 * i + 25, 10 * i, 10 * i + 25);
+	}
+
+	const auto index = dna::IntervalIndex::build(diffs);
+	const auto bytes = index.bytes();
+	CHECK(bytes.size() == 8 * dna::IntervalIndexView::serializedWords(3, diffs.size()));
+
+	// Stands in for a file read back (or mapped) by another job
+	std::vector<std::uint64_t> copy(bytes.size() / sizeof(std::uint64_t));
+	std::memcpy(copy.data(), bytes.data(), bytes.size());
+	const auto view = dna::IntervalIndexView::fromBytes(std::as_bytes(std::span<const std::uint64_t>(copy)));
+
+	CHECK(sorted(view.overlapping(1, 1000, 1100)) == brute_force(diffs, 1, 1000, 1100));
+
+	size_t calls = 0;
+	view.overlapping(0, 0, 10000, [&calls](std::uint32_t) { ++calls; });
+	CHECK(calls == 100);
+
+	SECTION("Malformed bytes are rejected")
+	{
+		auto words = std::as_bytes(std::span<const std::uint64_t>(copy));
+		CHECK_THROWS_AS(dna::IntervalIndexView::fromBytes(words.first(words.size() - 8)), std::invalid_argument);
+		CHECK_THROWS_AS(dna::IntervalIndexView::fromBytes(words.subspan(4)), std::invalid_argument);
+
+		copy[0] = 0;
+		CHECK_THROWS_AS(dna::IntervalIndexView::fromBytes(words), std::invalid_argument);
+	}
+
+	SECTION("Counts in a corrupt header are rejected")
+	{
+		auto words = std::as_bytes(std::span<const std::uint64_t>(copy));
+
+		// 2 x 2^63 chromosomes wraps around to a size that fits the buffer
+		copy[2] = std::uint64_t{1} << 63;
+		CHECK_THROWS_AS(dna::IntervalIndexView::fromBytes(words), std::invalid_argument);
+
+		copy[2] = 3;
+		copy[3] = ~std::uint64_t{0} / 3;
+		CHECK_THROWS_AS(dna::IntervalIndexView::fromBytes(words), std::invalid_argument);
+	}
+}
@@ -0,0 +1,488 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <iterator>
+#include <memory>
+#include <span>
+#include <stdexcept>
+#include <vector>
+#include <comparator.hpp>
+#include <difference.hpp>
+#include <helix_cursor.hpp>
+#include "procedural_stream.hpp"
+
+// A person derived from another by a seeded set of mutations, together with the ground
+// truth: exactly which events were applied, and where they ended up in both people. Comparing
+// the two should find every event (recall) and nothing else (precision), so benchmarks can
+// report accuracy alongside throughput.
+//
+// Nothing is copied out of the source person. A mutated chromosome is a list of segments,
+// each either copied from the source, reverse complemented from it, or generated, and bytes
+// are assembled from them on demand.
+
+struct mutation
+{
+	enum class kind
+	{
+		snp,
+		insertion,
+		deletion,
+		inversion,
+		// Bases lost from the end of a telomere; not a difference anyone should report
+		telomere_truncation,
+	};
+
+	kind type;
+	// Where the event is in the source (person_a) and in the mutated person (person_b)
+	dna::Difference where;
+};
+
+struct mutation_profile
+{
+	// Events per million bases between the telomeres
+	double snps = 1000;
+	double short_indels = 100;
+	double large_insertions = 1;
+	double large_deletions = 1;
+	double inversions = 0.5;
+
+	// Lengths are in bases, inclusive
+	std::size_t max_short_indel = 16;
+	std::size_t min_large = 500;
+	std::size_t max_large = 5000;
+	std::size_t min_inversion = 200;
+	std::size_t max_inversion = 2000;
+
+	// Chance of each telomere losing bases from its outer end
+	double telomere_truncation = 0.5;
+	// # of bases of each telomere that truncation always leaves
+	std::size_t min_telomere = 12;
+	// Unchanged bases between events, so that each one can be told apart
+	std::size_t min_spacing = 64;
+};
+
+// Draws from procedural::mix over a counter, so the same seed gives the same mutations
+class mutation_rng
+{
+	std::uint64_t state_;
+
+public:
+	explicit mutation_rng(std::uint64_t seed) :
+			state_(procedural::mix(seed))
+	{ }
+
+	std::uint64_t next() noexcept
+	{
+		return procedural::mix(state_++);
+	}
+
+	// Uniform in [0, 1)
+	double uniform() noexcept
+	{
+		return static_cast<double>(next() >> 11) * 0x1.0p-53;
+	}
+
+	// Uniform in [lo, hi]
+	std::size_t between(std::size_t lo, std::size_t hi) noexcept
+	{
+		return lo + next() % (hi - lo + 1);
+	}
+};
+
+template<dna::HelixStream Source>
+class mutated_stream
+{
+public:
+	struct segment
+	{
+		enum class kind : std::uint8_t
+		{
+			copy,               // source bases [source, source + length)
+			reverse_complement, // the same bases, reversed and complemented
+			substitute,         // source base `source`, shifted by `seed` (1-3)
+			generated,          // random bases drawn from `seed`
+		};
+
+		std::size_t start;  // first base in the mutated stream
+		std::size_t length;
+		std::size_t source;
+		std::uint64_t seed;
+		kind type;
+	};
+
+	using byte_view = fake_stream::byte_view;
+
+private:
+	Source source_;
+	std::shared_ptr<const std::vector<segment>> segments_;
+	std::size_t length_;     // in bases, always a whole # of bytes
+	std::size_t chunksize_;  // in bytes
+	long offset_;
+	std::vector<std::byte> chunk_;
+	std::vector<dna::base> source_bases_;
+	std::vector<dna::base> bases_;
+
+public:
+	// segments must cover [0, length) of the stream in order, with no gaps
+	mutated_stream(Source source, std::shared_ptr<const std::vector<segment>> segments, std::size_t chunksize = 1 << 16) :
+			source_(std::move(source)),
+			segments_(std::move(segments)),
+			length_(segments_->empty() ? 0 : segments_->back().start + segments_->back().length),
+			chunksize_(std::max<std::size_t>(chunksize, 1)),
+			offset_(0)
+	{
+		if (length_ % dna::packed_size::value != 0)
+			throw std::invalid_argument("chromosome length must be a whole number of bytes");
+	}
+
+	// Copies share the source and segments; the read buffers are per stream
+	mutated_stream(const mutated_stream& other) :
+			source_(other.source_),
+			segments_(other.segments_),
+			length_(other.length_),
+			chunksize_(other.chunksize_),
+			offset_(other.offset_)
+	{ }
+
+	mutated_stream(mutated_stream&&) noexcept = default;
+
+	mutated_stream& operator=(const mutated_stream& other)
+	{
+		if (this != &other)
+		{
+			mutated_stream copy(other);
+			*this = std::move(copy);
+		}
+		return *this;
+	}
+
+	mutated_stream& operator=(mutated_stream&&) noexcept = default;
+
+	void seek(long offset)
+	{
+		offset_ = std::clamp(offset, 0L, size());
+	}
+
+	long size() const
+	{
+		return static_cast<long>(length_ / dna::packed_size::value);
+	}
+
+	// The next chunk; valid until the next call to read()
+	dna::sequence_buffer<byte_view> read()
+	{
+		chunk_.resize(chunksize_);
+		const std::size_t count = read_at(offset_, chunk_);
+		offset_ += static_cast<long>(count);
+		return byte_view(chunk_.data(), count);
+	}
+
+	// Fills out with the bytes starting at offset, without moving the read position.
+	// Returns the # of bytes written, which is less than out.size() only at the end.
+	std::size_t read_at(long offset, std::span<std::byte> out)
+	{
+		const auto first = static_cast<std::size_t>(std::clamp(offset, 0L, size()));
+		const std::size_t count = std::min(out.size(), static_cast<std::size_t>(size()) - first);
+		if (count == 0)
+			return 0;
+
+		const std::size_t begin = first * dna::packed_size::value;
+		const std::size_t end = (first + count) * dna::packed_size::value;
+
+		const auto& segments = *segments_;
+		const auto lo = std::prev(std::upper_bound(segments.begin(), segments.end(), begin,
+				[](std::size_t position, const segment& s) { return position < s.start; }));
+		const auto hi = std::lower_bound(lo, segments.end(), end,
+				[](const segment& s, std::size_t position) { return s.start < position; });
+
+		// Everything these segments take from the source is read in one go, since the
+		// segments are in the same order as the bases they came from
+		std::size_t source_begin = SIZE_MAX;
+		std::size_t source_end = 0;
+		for (auto s = lo; s != hi; ++s)
+		{
+			if (s->type == segment::kind::generated)
+				continue;
+
+			std::size_t from = s->source;
+			std::size_t to = s->source + s->length;
+			if (s->type == segment::kind::copy)
+			{
+				from += std::max(begin, s->start) - s->start;
+				to -= s->start + s->length - std::min(end, s->start + s->length);
+			}
+			source_begin = std::min(source_begin, from);
+			source_end = std::max(source_end, to);
+		}
+
+		source_bases_.clear();
+		if (source_begin < source_end)
+			dna::read_bases(source_, source_begin, source_end, source_bases_);
+
+		bases_.clear();
+		for (auto s = lo; s != hi; ++s)
+		{
+			const std::size_t from = std::max(begin, s->start) - s->start;
+			const std::size_t to = std::min(end, s->start + s->length) - s->start;
+			auto at = [&](std::size_t source_idx) { return source_bases_.data() + (source_idx - source_begin); };
+
+			switch (s->type)
+			{
+				case segment::kind::copy:
+					bases_.insert(bases_.end(), at(s->source + from), at(s->source + to));
+					break;
+				case segment::kind::reverse_complement:
+					for (std::size_t i = from; i < to; ++i)
+						bases_.push_back(dna::complement(*at(s->source + s->length - 1 - i)));
+					break;
+				case segment::kind::substitute:
+					bases_.push_back(static_cast<dna::base>((static_cast<std::uint64_t>(*at(s->source)) + s->seed) % 4));
+					break;
+				case segment::kind::generated:
+					for (std::size_t i = from; i < to; ++i)
+						bases_.push_back(static_cast<dna::base>((procedural::mix(s->seed + i / 32) >> (2 * (i % 32))) & 0x3));
+					break;
+			}
+		}
+
+		for (std::size_t i = 0; i < count; ++i)
+		{
+			const dna::base* b = bases_.data() + dna::packed_size::value * i;
+			out[i] = dna::pack(b[0], b[1], b[2], b[3]);
+		}
+
+		return count;
+	}
+};
+
+template<dna::Person P>
+class mutated_person
+{
+public:
+	using stream = mutated_stream<dna::chromosome_t<P>>;
+	using segment = typename stream::segment;
+
+private:
+	std::vector<stream> chroms_;
+	// Shared, since copies of a whole genome's worth of events aren't cheap
+	std::shared_ptr<const std::vector<mutation>> truth_;
+
+public:
+	// Each chromosome's mutations are drawn from its own generator, keyed by seed and index.
+	// Throws std::invalid_argument if a chromosome has to lose bases to stay a whole # of
+	// bytes and has no back telomere to lose them from.
+	mutated_person(const P& source, std::uint64_t seed, const mutation_profile& profile = {},
+			std::size_t chunk_size = 1 << 16)
+	{
+		auto truth = std::make_shared<std::vector<mutation>>();
+		chroms_.reserve(source.chromosomes());
+
+		for (std::size_t i = 0; i < source.chromosomes(); ++i)
+		{
+			auto helix = source.chromosome(i);
+			const auto data_range = dna::Comparator::getDataRange(helix);
+			const std::size_t length = static_cast<std::size_t>(helix.size()) * dna::packed_size::value;
+
+			mutation_rng rng(seed ^ procedural::mix(i + 1));
+			auto segments = std::make_shared<std::vector<segment>>(mutate(i, length, data_range, profile, rng, *truth));
+			chroms_.emplace_back(source.chromosome(i), std::move(segments), chunk_size);
+		}
+
+		truth_ = std::move(truth);
+	}
+
+	const stream& chromosome(std::size_t chromosome_index) const
+	{
+		if (chromosome_index >= chroms_.size())
+			throw std::invalid_argument("index is out of range for the number of chromosomes available");
+
+		return chroms_[chromosome_index];
+	}
+
+	std::size_t chromosomes() const
+	{
+		return chroms_.size();
+	}
+
+	// Every event applied, in order of chromosome and then position
+	const std::vector<mutation>& truth() const
+	{
+		return *truth_;
+	}
+
+private:
+	static std::vector<segment> mutate(std::size_t chromosome_idx, std::size_t length, std::pair<std::size_t, std::size_t> data_range,
+			const mutation_profile& profile, mutation_rng& rng, std::vector<mutation>& truth)
+	{
+		const auto [data_start, data_end] = data_range;
+		std::vector<segment> segments;
+
+		// Next base of the source and of the mutated stream
+		std::size_t a = 0;
+		std::size_t b = 0;
+
+		auto emit = [&](typename segment::kind type, std::size_t a_length, std::size_t b_length, std::uint64_t seed) {
+			if (b_length > 0)
+				segments.push_back({b, b_length, a, seed, type});
+			a += a_length;
+			b += b_length;
+		};
+		auto copy_to = [&](std::size_t a_end) {
+			if (a_end > a)
+				emit(segment::kind::copy, a_end - a, a_end - a, 0);
+		};
+		auto record = [&](mutation::kind type, std::size_t a_length, std::size_t b_length) {
+			truth.push_back({type, dna::Difference(chromosome_idx, a, a + a_length, b, b + b_length)});
+		};
+		auto truncation = [&](std::size_t telomere) {
+			if (telomere <= profile.min_telomere || rng.uniform() >= profile.telomere_truncation)
+				return std::size_t{0};
+			return rng.between(1, telomere - profile.min_telomere);
+		};
+
+		if (const std::size_t cut = truncation(data_start); cut > 0)
+		{
+			record(mutation::kind::telomere_truncation, cut, 0);
+			emit(segment::kind::copy, cut, 0, 0);
+		}
+
+		const double rate = profile.snps + profile.short_indels + profile.large_insertions + profile.large_deletions + profile.inversions;
+		const double mean_gap = rate > 0 ? 1e6 / rate : 0;
+
+		for (std::size_t position = data_start; rate > 0;)
+		{
+			position += profile.min_spacing + static_cast<std::size_t>(-std::log1p(-rng.uniform()) * mean_gap);
+
+			std::size_t a_length = 0;
+			std::size_t b_length = 0;
+			auto type = mutation::kind::snp;
+
+			double pick = rng.uniform() * rate;
+			if ((pick -= profile.snps) < 0)
+			{
+				a_length = b_length = 1;
+			}
+			else if ((pick -= profile.short_indels) < 0)
+			{
+				type = rng.next() & 1 ? mutation::kind::insertion : mutation::kind::deletion;
+				(type == mutation::kind::insertion ? b_length : a_length) = rng.between(1, profile.max_short_indel);
+			}
+			else if ((pick -= profile.large_insertions) < 0)
+			{
+				type = mutation::kind::insertion;
+				b_length = rng.between(profile.min_large, profile.max_large);
+			}
+			else if ((pick -= profile.large_deletions) < 0)
+			{
+				type = mutation::kind::deletion;
+				a_length = rng.between(profile.min_large, profile.max_large);
+			}
+			else
+			{
+				type = mutation::kind::inversion;
+				a_length = b_length = rng.between(profile.min_inversion, profile.max_inversion);
+			}
+
+			if (position + a_length + profile.min_spacing > data_end)
+				break;
+
+			copy_to(position);
+			record(type, a_length, b_length);
+			switch (type)
+			{
+				case mutation::kind::snp:
+					emit(segment::kind::substitute, 1, 1, rng.between(1, 3));
+					break;
+				case mutation::kind::inversion:
+					emit(segment::kind::reverse_complement, a_length, b_length, 0);
+					break;
+				default:
+					emit(segment::kind::generated, a_length, b_length, rng.next());
+					break;
+			}
+			position = a;
+		}
+
+		// The back telomere also loses whatever it takes to keep the stream whole bytes
+		const std::size_t back_telomere = length - data_end;
+		std::size_t cut = truncation(back_telomere);
+		cut += (b + length - a - cut) % dna::packed_size::value;
+		if (cut > back_telomere)
+			throw std::invalid_argument("chromosome has no back telomere to trim to a whole number of bytes");
+
+		copy_to(length - cut);
+		if (cut > 0)
+			record(mutation::kind::telomere_truncation, cut, 0);
+
+		return segments;
+	}
+};
+
+struct accuracy
+{
+	std::size_t true_positives = 0;   // events that were reported
+	std::size_t false_negatives = 0;  // events that weren't
+	std::size_t reported = 0;         // differences reported
+	std::size_t false_positives = 0;  // differences that don't correspond to any event
+
+	double recall() const
+	{
+		const std::size_t events = true_positives + false_negatives;
+		return events == 0 ? 1.0 : static_cast<double>(true_positives) / static_cast<double>(events);
+	}
+
+	double precision() const
+	{
+		return reported == 0 ? 1.0 : static_cast<double>(reported - false_positives) / static_cast<double>(reported);
+	}
+};
+
+// Matches reported differences against the ground truth by their positions in person_a.
+// An event and a difference match if they are on the same chromosome and overlap, or come
+// within tolerance bases of doing so; aligners are free to place an indel anywhere within a
+// repeat, and to merge events that are close together. Telomere truncations are ignored.
+inline accuracy score(std::span<const mutation> truth, std::span<const dna::Difference> found, std::size_t tolerance = 16)
+{
+	std::vector<dna::Difference> events;
+	for (const auto& m : truth)
+		if (m.type != mutation::kind::telomere_truncation)
+			events.push_back(m.where);
+	std::vector<dna::Difference> reported(found.begin(), found.end());
+
+	// Empty ranges (insertions) still occupy the point they happen at
+	auto start = [](const dna::Difference& d) { return d.person_a.first; };
+	auto end = [](const dna::Difference& d) { return std::max(d.person_a.second, d.person_a.first + 1); };
+	auto before = [&](const dna::Difference& l, const dna::Difference& r) {
+		return std::pair(l.chromosome_idx, start(l)) < std::pair(r.chromosome_idx, start(r));
+	};
+	std::sort(events.begin(), events.end(), before);
+	std::sort(reported.begin(), reported.end(), before);
+
+	// Neither list has overlapping entries, so ends are in order too and the search can stop
+	// at the first candidate that ends too early
+	auto matched = [&](const std::vector<dna::Difference>& sorted, const dna::Difference& d) {
+		auto it = std::lower_bound(sorted.begin(), sorted.end(), std::pair(d.chromosome_idx, end(d) + tolerance),
+				[&](const dna::Difference& x, const auto& key) { return std::pair(x.chromosome_idx, start(x)) < key; });
+		while (it != sorted.begin())
+		{
+			--it;
+			if (it->chromosome_idx != d.chromosome_idx || end(*it) + tolerance <= start(d))
+				return false;
+			if (start(*it) < end(d) + tolerance)
+				return true;
+		}
+		return false;
+	};
+
+	accuracy result{};
+	for (const auto& e : events)
+		++(matched(reported, e) ? result.true_positives : result.false_negatives);
+
+	result.reported = reported.size();
+	for (const auto& r : reported)
+		result.false_positives += !matched(events, r);
+
+	return result;
+}
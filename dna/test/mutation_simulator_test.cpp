@@ -0,0 +1,109 @@
+#include "catch.hpp"
+#include "mutation_simulator.hpp"
+
+#include <comparator.hpp>
+
+namespace
+{
+
+mutation_profile dense_profile()
+{
+	// Enough of every kind of event to turn up in a small genome
+	mutation_profile profile{};
+	profile.large_insertions = 20;
+	profile.large_deletions = 20;
+	profile.inversions = 20;
+	profile.telomere_truncation = 1.0;
+	return profile;
+}
+
+std::vector<dna::base> all_bases(auto helix)
+{
+	std::vector<dna::base> bases;
+	dna::read_bases(helix, 0, static_cast<std::size_t>(helix.size()) * dna::packed_size::value, bases);
+	return bases;
+}
+
+}
+
+TEST_CASE("Mutated people differ from their source by exactly the ground truth", "[mutation]")
+{
+	procedural_person a(5, 1, procedural_person::sex::x, 1e-3, 4096);
+	mutated_person b(a, 17, dense_profile(), 1000);
+
+	std::array<std::size_t, 5> kinds{};
+	for (const auto& m : b.truth())
+		++kinds[static_cast<std::size_t>(m.type)];
+	for (auto count : kinds)
+		CHECK(count > 0);
+
+	// Walk each chromosome of b, replaying the events on a as they come up
+	std::size_t mismatches = 0;
+	auto event = b.truth().begin();
+	for (std::size_t chrom = 0; chrom < a.chromosomes(); ++chrom)
+	{
+		const auto bases_a = all_bases(a.chromosome(chrom));
+		const auto bases_b = all_bases(b.chromosome(chrom));
+
+		std::size_t i = 0;
+		std::size_t j = 0;
+		for (; event != b.truth().end() && event->where.chromosome_idx == chrom; ++event)
+		{
+			const auto [a_start, a_end] = event->where.person_a;
+			const auto [b_start, b_end] = event->where.person_b;
+			mismatches += a_start - i != b_start - j;
+			mismatches += !std::equal(bases_a.begin() + i, bases_a.begin() + a_start, bases_b.begin() + j);
+
+			if (event->type == mutation::kind::snp)
+				mismatches += bases_a[a_start] == bases_b[b_start];
+			if (event->type == mutation::kind::inversion)
+				mismatches += !std::equal(bases_a.rbegin() + (bases_a.size() - a_end), bases_a.rbegin() + (bases_a.size() - a_start),
+						bases_b.begin() + b_start, [](auto x, auto y) { return dna::complement(x) == y; });
+
+			i = a_end;
+			j = b_end;
+		}
+
+		REQUIRE(bases_a.size() - i == bases_b.size() - j);
+		mismatches += !std::equal(bases_a.begin() + i, bases_a.end(), bases_b.begin() + j);
+	}
+	CHECK(mismatches == 0);
+	CHECK(event == b.truth().end());
+
+	// Reading in chunks gives the same bytes as reading in one go
+	auto helix = b.chromosome(3);
+	std::vector<std::byte> whole(static_cast<std::size_t>(helix.size()));
+	REQUIRE(helix.read_at(0, whole) == whole.size());
+	std::vector<std::byte> chunked;
+	for (auto seq = helix.read(); seq.size() > 0; seq = helix.read())
+		chunked.insert(chunked.end(), seq.buffer().begin(), seq.buffer().end());
+	CHECK(chunked == whole);
+
+	// The same seed gives the same mutations
+	mutated_person again(a, 17, dense_profile());
+	CHECK(again.truth().size() == b.truth().size());
+	CHECK(again.truth().back().where == b.truth().back().where);
+}
+
+TEST_CASE("Comparing against a mutated person finds its mutations", "[mutation]")
+{
+	procedural_person a(5, 1, procedural_person::sex::x, 1e-3, 4096);
+	mutated_person b(a, 23, dense_profile());
+
+	const auto found = dna::Comparator::compare(a, b);
+
+	// getSex goes by length, so at this scale the sex chromosomes aren't compared at all
+	std::vector<mutation> truth;
+	std::copy_if(b.truth().begin(), b.truth().end(), std::back_inserter(truth),
+			[](const mutation& m) { return m.where.chromosome_idx != 22; });
+	const auto result = score(truth, found);
+
+	CHECK(result.true_positives > 1000);
+	CHECK(result.recall() > 0.99);
+	CHECK(result.precision() > 0.99);
+
+	// Nothing found means nothing recalled, and nothing reported can't be wrong
+	const auto none = score(truth, {});
+	CHECK(none.recall() == 0.0);
+	CHECK(none.precision() == 1.0);
+}
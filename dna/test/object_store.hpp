@@ -0,0 +1,261 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+#include <file_stream.hpp>
+#include "procedural_stream.hpp"
+
+// A local stand-in for an object store like S3, for trying out chunk sizes and read-ahead
+// depths against storage that behaves like the real thing without touching the network.
+//
+// An object is a file, read a byte range per request the way an HTTP GET with a Range
+// header reads it. Every request waits out a time to first byte, then transfers at a
+// limited rate, and now and then returns fewer bytes than asked for (as a dropped
+// connection would), which callers have to retry. Requests sleep rather than spin, so
+// requests in parallel overlap just as they would over the network.
+
+// Inclusive at both ends, like an HTTP Range header
+struct byte_range
+{
+	long first;
+	long last;
+
+	long length() const noexcept
+	{
+		return last - first + 1;
+	}
+
+	std::string header() const
+	{
+		return "bytes=" + std::to_string(first) + "-" + std::to_string(last);
+	}
+};
+
+struct object_store_profile
+{
+	std::chrono::microseconds latency{20'000}; // time to first byte of each request
+	double bandwidth = 100e6;                  // bytes per second per request, 0 for unlimited
+	double short_read_rate = 0.01;             // fraction of requests cut short
+	std::uint64_t seed = 1;                    // of which requests are cut short
+};
+
+class object_store
+{
+public:
+	struct statistics
+	{
+		std::atomic<std::uint64_t> requests{0};
+		std::atomic<std::uint64_t> bytes{0};
+		std::atomic<std::uint64_t> short_reads{0};
+	};
+
+private:
+	dna::file_stream file_;
+	object_store_profile profile_;
+	mutable statistics stats_;
+
+public:
+	explicit object_store(const std::string& path, object_store_profile p = {}) :
+			file_(path),
+			profile_(p)
+	{ }
+
+	long size() const
+	{
+		return file_.size();
+	}
+
+	const statistics& stats() const noexcept
+	{
+		return stats_;
+	}
+
+	// One GET of range into out, which must hold range.length() bytes. Returns the # of
+	// bytes from range.first that were written, which is less than asked for on a short
+	// read, or if the range runs past the end of the object.
+	std::size_t get(byte_range range, std::span<std::byte> out) const
+	{
+		if (range.first < 0 || range.last < range.first || out.size() < static_cast<std::size_t>(range.length()))
+			throw std::invalid_argument("invalid byte range " + range.header());
+
+		const std::uint64_t request = stats_.requests++;
+		std::size_t count = std::min(static_cast<std::size_t>(range.length()),
+				static_cast<std::size_t>(std::max(size() - range.first, 0L)));
+
+		const std::uint64_t r = procedural::mix(profile_.seed ^ procedural::mix(request));
+		if (count > 1 && static_cast<double>(r >> 11) * 0x1p-53 < profile_.short_read_rate)
+		{
+			count = 1 + procedural::mix(r) % (count - 1);
+			++stats_.short_reads;
+		}
+
+		auto wait = std::chrono::duration<double>(profile_.latency);
+		if (profile_.bandwidth > 0)
+			wait += std::chrono::duration<double>(static_cast<double>(count) / profile_.bandwidth);
+		std::this_thread::sleep_for(wait);
+
+		stats_.bytes += count;
+		return file_.read_at(range.first, out.first(count));
+	}
+
+	// Fetches ranges (in order, not overlapping) into out, one after the other. Ranges no
+	// more than coalesce_gap bytes apart (by default, adjacent ones) are merged into one
+	// request, as long as that stays within max_request bytes, and up to parallel requests
+	// are in flight at once. Short reads are retried for the rest of the range. Returns the
+	// # of requests sent, not counting retries.
+	std::size_t get_ranges(std::span<const byte_range> ranges, std::span<std::byte> out, std::size_t parallel = 1,
+			long coalesce_gap = 0, long max_request = 8 << 20) const
+	{
+		struct request
+		{
+			byte_range range;
+			std::vector<std::size_t> parts; // indexes into ranges
+		};
+
+		std::vector<request> requests;
+		for (std::size_t i = 0; i < ranges.size(); ++i)
+		{
+			if (!requests.empty())
+			{
+				auto& last = requests.back().range;
+				if (ranges[i].first - last.last - 1 <= coalesce_gap && ranges[i].last - last.first + 1 <= max_request)
+				{
+					last.last = ranges[i].last;
+					requests.back().parts.push_back(i);
+					continue;
+				}
+			}
+			requests.push_back({ranges[i], {i}});
+		}
+
+		std::vector<std::size_t> offsets(ranges.size() + 1, 0);
+		for (std::size_t i = 0; i < ranges.size(); ++i)
+			offsets[i + 1] = offsets[i] + static_cast<std::size_t>(ranges[i].length());
+		if (out.size() < offsets.back())
+			throw std::invalid_argument("output is too small for the ranges");
+
+		std::atomic<std::size_t> next{0};
+		auto work = [&] {
+			std::vector<std::byte> buffer;
+			for (std::size_t i = next++; i < requests.size(); i = next++)
+			{
+				const auto& req = requests[i];
+				buffer.resize(static_cast<std::size_t>(req.range.length()));
+				std::size_t done = 0;
+				while (static_cast<long>(done) < req.range.length())
+				{
+					const byte_range rest{req.range.first + static_cast<long>(done), req.range.last};
+					const std::size_t n = get(rest, std::span(buffer).subspan(done));
+					if (n == 0)
+						break;
+					done += n;
+				}
+
+				for (auto part : req.parts)
+				{
+					const auto from = static_cast<std::size_t>(ranges[part].first - req.range.first);
+					const auto length = static_cast<std::size_t>(ranges[part].length());
+					std::copy_n(buffer.begin() + static_cast<long>(from), std::min(length, done - std::min(done, from)), out.begin() + static_cast<long>(offsets[part]));
+				}
+			}
+		};
+
+		{
+			std::vector<std::jthread> workers;
+			for (std::size_t t = 1; t < std::min(parallel, requests.size()); ++t)
+				workers.emplace_back(work);
+			work();
+		}
+
+		return requests.size();
+	}
+};
+
+// A chromosome stored as an object (or a byte range of one). Each read() fetches the next
+// chunk_size bytes as parallel requests of part_size bytes, the way S3 clients download
+// large objects; wrap it in a dna::readahead_stream to keep chunks in flight as well.
+class object_store_stream
+{
+	std::shared_ptr<const object_store> store_;
+	long begin_;
+	long size_;
+	std::size_t chunk_size_;
+	std::size_t part_size_;
+	long offset_;
+	std::vector<std::byte> chunk_;
+
+public:
+	object_store_stream(std::shared_ptr<const object_store> store, std::size_t chunk_size = 1 << 20,
+			std::size_t part_size = 1 << 18, long begin = 0, long size = -1) :
+			store_(std::move(store)),
+			begin_(begin),
+			size_(size < 0 ? store_->size() - begin : size),
+			chunk_size_(std::max<std::size_t>(chunk_size, 1)),
+			part_size_(std::max<std::size_t>(part_size, 1)),
+			offset_(0),
+			chunk_()
+	{
+		if (begin_ < 0 || size_ < 0 || begin_ + size_ > store_->size())
+			throw std::invalid_argument("range is outside the object");
+	}
+
+	// Copies only share the store; the read buffer is per stream
+	object_store_stream(const object_store_stream& other) :
+			store_(other.store_),
+			begin_(other.begin_),
+			size_(other.size_),
+			chunk_size_(other.chunk_size_),
+			part_size_(other.part_size_),
+			offset_(other.offset_),
+			chunk_()
+	{ }
+
+	object_store_stream(object_store_stream&&) noexcept = default;
+
+	void seek(long offset)
+	{
+		offset_ = std::clamp(offset, 0L, size_);
+	}
+
+	long size() const
+	{
+		return size_;
+	}
+
+	// The next chunk; valid until the next call to read()
+	dna::sequence_buffer<std::span<const std::byte>> read()
+	{
+		chunk_.resize(chunk_size_);
+		const std::size_t count = read_at(offset_, chunk_);
+		offset_ += static_cast<long>(count);
+		return {std::span<const std::byte>(chunk_.data(), count), count * dna::packed_size::value};
+	}
+
+	// Fills out with the bytes starting at offset, fetching parts of it in parallel, without
+	// moving the read position. Returns the # of bytes written, which is less than
+	// out.size() only at the end.
+	std::size_t read_at(long offset, std::span<std::byte> out) const
+	{
+		const long first = std::clamp(offset, 0L, size_);
+		const auto count = std::min(out.size(), static_cast<std::size_t>(size_ - first));
+
+		std::vector<byte_range> parts;
+		for (std::size_t done = 0; done < count; done += part_size_)
+		{
+			const auto length = std::min(part_size_, count - done);
+			const long start = begin_ + first + static_cast<long>(done);
+			parts.push_back({start, start + static_cast<long>(length) - 1});
+		}
+
+		store_->get_ranges(parts, out.first(count), parts.size(), -1);
+		return count;
+	}
+};
@@ -0,0 +1,85 @@
+#include "catch.hpp"
+#include "object_store.hpp"
+#include "temporary_file.hpp"
+
+#include <chrono>
+#include <readahead_stream.hpp>
+
+namespace
+{
+
+std::vector<std::byte> object_bytes()
+{
+	const procedural_stream source(5, 9, 200'000, 11);
+	std::vector<std::byte> bytes(static_cast<std::size_t>(source.size()));
+	source.read_at(0, bytes);
+	return bytes;
+}
+
+}
+
+TEST_CASE("Object store requests are retried until they have every byte", "[object_store]")
+{
+	const auto expected = object_bytes();
+	const temporary_file file(expected);
+
+	object_store_profile profile{};
+	profile.latency = std::chrono::microseconds(0);
+	profile.bandwidth = 0;
+	profile.short_read_rate = 0.3;
+	const auto store = std::make_shared<const object_store>(file.path(), profile);
+
+	object_store_stream helix(store, 4096, 1000);
+	std::vector<std::byte> bytes;
+	for (auto seq = helix.read(); seq.size() > 0; seq = helix.read())
+		bytes.insert(bytes.end(), seq.buffer().begin(), seq.buffer().end());
+	CHECK(bytes == expected);
+	CHECK(store->stats().short_reads > 0);
+	CHECK(store->stats().bytes == expected.size());
+
+	CHECK(byte_range{100, 199}.header() == "bytes=100-199");
+	std::vector<std::byte> out(100);
+	CHECK(store->get({static_cast<long>(expected.size()) - 10, static_cast<long>(expected.size()) + 89}, out) <= 10);
+
+	// Read ahead goes through read_at, and gets the same bytes
+	dna::readahead_stream ahead(helix, 3, 5000);
+	ahead.seek(0);
+	auto seq = ahead.read();
+	CHECK(std::equal(seq.buffer().begin(), seq.buffer().end(), expected.begin()));
+}
+
+TEST_CASE("Object store ranges are coalesced and fetched in parallel", "[object_store]")
+{
+	const auto expected = object_bytes();
+	const temporary_file file(expected);
+
+	object_store_profile profile{};
+	profile.latency = std::chrono::milliseconds(20);
+	profile.bandwidth = 0;
+	profile.short_read_rate = 0;
+	const object_store store(file.path(), profile);
+
+	// Two runs of nearby ranges, far apart from each other
+	const std::vector<byte_range> ranges = {{0, 99}, {110, 199}, {200, 299}, {30'000, 30'099}, {30'100, 30'199}};
+	std::vector<std::byte> out(490);
+
+	CHECK(store.get_ranges(ranges, out, 1, -1) == ranges.size());
+	CHECK(store.get_ranges(ranges, out) == 3);
+	CHECK(store.get_ranges(ranges, out, 1, 16) == 2);
+	CHECK(store.get_ranges(ranges, out, 1, 16, 190) == 4);
+
+	std::size_t at = 0;
+	std::size_t mismatches = 0;
+	for (const auto& range : ranges)
+	{
+		mismatches += !std::equal(out.begin() + static_cast<long>(at), out.begin() + static_cast<long>(at + static_cast<std::size_t>(range.length())),
+				expected.begin() + range.first);
+		at += static_cast<std::size_t>(range.length());
+	}
+	CHECK(mismatches == 0);
+
+	// Five requests at once take about as long as one
+	const auto start = std::chrono::steady_clock::now();
+	store.get_ranges(ranges, out, ranges.size(), -1);
+	CHECK(std::chrono::steady_clock::now() - start < 3 * profile.latency);
+}
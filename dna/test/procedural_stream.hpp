@@ -0,0 +1,270 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include "fake_stream.hpp"
+
+// HelixStreams and Persons whose bases are generated on the fly, for testing and
+// benchmarking at genome scale without holding any data in memory.
+//
+// Every byte is a pure function of its position: the bases between the telomeres come
+// from a counter-based generator keyed by (genome seed, chromosome), and are addressed
+// relative to the end of the front telomeres. People generated from the same genome seed
+// are therefore identical apart from their telomeres, whose lengths come from each
+// person's own seed. Telomeres always meet the data with a whole TTAGGG repeat, so a
+// length that isn't a multiple of 6 is a telomere the sequencer started reading mid-way.
+
+namespace procedural
+{
+
+// SplitMix64's finalizer: a bijective mix, good enough to make a counter look random
+constexpr std::uint64_t mix(std::uint64_t x) noexcept
+{
+	x += 0x9E3779B97F4A7C15ull;
+	x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ull;
+	x = (x ^ (x >> 27)) * 0x94D049BB133111EBull;
+	return x ^ (x >> 31);
+}
+
+inline constexpr std::array<dna::base, 6> TELOMERE_SEQ = {dna::T, dna::T, dna::A, dna::G, dna::G, dna::G};
+
+// GRCh38 chromosome lengths in bases: 1-22, then X and Y
+inline constexpr std::array<std::size_t, 24> CHROMOSOME_LENGTHS = {
+	248'956'422, 242'193'529, 198'295'559, 190'214'555, 181'538'259, 170'805'979,
+	159'345'973, 145'138'636, 138'394'717, 133'797'422, 135'086'622, 133'275'309,
+	114'364'328, 107'043'718, 101'991'189,  90'338'345,  83'257'441,  80'373'285,
+	 58'617'616,  64'444'167,  46'709'983,  50'818'468, 156'040'895,  57'227'415,
+};
+
+}
+
+class procedural_stream
+{
+	std::uint64_t key_;
+	std::size_t length_;          // in bases, always a whole # of bytes
+	std::size_t front_telomere_;  // in bases
+	std::size_t back_telomere_;   // in bases
+	std::size_t chunksize_;       // in bytes
+	long offset_;
+	std::vector<std::byte> chunk_;
+
+public:
+	using byte_view = fake_stream::byte_view;
+
+	procedural_stream() :
+			procedural_stream(0, 0, 0, 0)
+	{ }
+
+	// Lengths are in bases. Throws if they don't add up to a whole # of bytes.
+	procedural_stream(std::uint64_t key, std::size_t front_telomere, std::size_t data_length, std::size_t back_telomere,
+			std::size_t chunksize = 1 << 16) :
+			key_(key),
+			length_(front_telomere + data_length + back_telomere),
+			front_telomere_(front_telomere),
+			back_telomere_(back_telomere),
+			chunksize_(std::max<std::size_t>(chunksize, 1)),
+			offset_(0),
+			chunk_()
+	{
+		if (length_ % dna::packed_size::value != 0)
+			throw std::invalid_argument("chromosome length must be a whole number of bytes");
+	}
+
+	// Copies only share the parameters; the read buffer is per stream
+	procedural_stream(const procedural_stream& other) :
+			key_(other.key_),
+			length_(other.length_),
+			front_telomere_(other.front_telomere_),
+			back_telomere_(other.back_telomere_),
+			chunksize_(other.chunksize_),
+			offset_(other.offset_),
+			chunk_()
+	{ }
+
+	procedural_stream(procedural_stream&&) noexcept = default;
+
+	procedural_stream& operator=(const procedural_stream& other)
+	{
+		if (this != &other)
+		{
+			procedural_stream copy(other);
+			*this = std::move(copy);
+		}
+		return *this;
+	}
+
+	procedural_stream& operator=(procedural_stream&&) noexcept = default;
+
+	void seek(long offset)
+	{
+		offset_ = std::clamp(offset, 0L, size());
+	}
+
+	long size() const
+	{
+		return static_cast<long>(length_ / dna::packed_size::value);
+	}
+
+	// [start, end) of the bases between the telomeres, as getDataRange should find it
+	std::pair<std::size_t, std::size_t> data_range() const noexcept
+	{
+		return {front_telomere_, length_ - back_telomere_};
+	}
+
+	// The next chunk; valid until the next call to read()
+	dna::sequence_buffer<byte_view> read()
+	{
+		chunk_.resize(chunksize_);
+		const std::size_t count = read_at(offset_, chunk_);
+		offset_ += static_cast<long>(count);
+		return byte_view(chunk_.data(), count);
+	}
+
+	// Fills out with the bytes starting at offset, without moving the read position.
+	// Returns the # of bytes written, which is less than out.size() only at the end.
+	std::size_t read_at(long offset, std::span<std::byte> out) const
+	{
+		const auto first = static_cast<std::size_t>(std::clamp(offset, 0L, size()));
+		const std::size_t count = std::min(out.size(), static_cast<std::size_t>(size()) - first);
+
+		// Bytes made up entirely of ordinary data bases (excluding the first and last,
+		// which are adjusted to stop the telomeres running on) take the fast path
+		const std::size_t fast_begin = (front_telomere_ + 1 + 3) / 4;
+		const std::size_t data_last = length_ - back_telomere_;
+		const std::size_t fast_end = data_last >= 2 ? (data_last - 1) / 4 : 0;
+
+		const std::size_t shift = 2 * (front_telomere_ % 4);
+		const std::size_t whole = front_telomere_ / 4;
+
+		std::uint64_t word_idx = UINT64_MAX;
+		std::uint64_t word = 0;
+		auto data_byte = [&](std::size_t idx) {
+			if (idx / 8 != word_idx)
+			{
+				word_idx = idx / 8;
+				word = procedural::mix(key_ ^ procedural::mix(word_idx));
+			}
+			return static_cast<std::uint8_t>(word >> (8 * (idx % 8)));
+		};
+
+		for (std::size_t i = 0; i < count; ++i)
+		{
+			const std::size_t idx = first + i;
+			if (idx >= fast_begin && idx < fast_end)
+			{
+				// Byte idx holds data bases 4 * idx - front_telomere_ onwards, which straddle
+				// two data bytes unless the telomeres are a whole # of bytes
+				const std::size_t data_idx = idx - whole;
+				const std::uint8_t hi = shift == 0 ? data_byte(data_idx) : static_cast<std::uint8_t>(data_byte(data_idx - 1) << (8 - shift));
+				const std::uint8_t lo = shift == 0 ? 0 : static_cast<std::uint8_t>(data_byte(data_idx) >> shift);
+				out[i] = static_cast<std::byte>(hi | lo);
+			}
+			else
+			{
+				const std::size_t b = 4 * idx;
+				out[i] = dna::pack(base_at(b), base_at(b + 1), base_at(b + 2), base_at(b + 3));
+			}
+		}
+
+		return count;
+	}
+
+	// Base idx of the chromosome, the slow way
+	dna::base base_at(std::size_t idx) const noexcept
+	{
+		const std::size_t data_end = length_ - back_telomere_;
+		constexpr std::size_t repeat = procedural::TELOMERE_SEQ.size();
+		if (idx < front_telomere_)
+			return procedural::TELOMERE_SEQ[(repeat - (front_telomere_ - idx) % repeat) % repeat];
+		if (idx >= data_end)
+			return procedural::TELOMERE_SEQ[(idx - data_end) % repeat];
+
+		const std::size_t data_idx = idx - front_telomere_;
+		const std::size_t byte_idx = data_idx / 4;
+		const std::uint64_t word = procedural::mix(key_ ^ procedural::mix(byte_idx / 8));
+		const auto packed = static_cast<std::byte>(word >> (8 * (byte_idx % 8)));
+		auto value = dna::unpack(packed)[data_idx % 4];
+
+		// The bases either side of the data must break the telomere pattern, or telomere
+		// detection would (rightly) count them as part of the telomeres
+		if (idx == front_telomere_ && value == procedural::TELOMERE_SEQ.front())
+			value = static_cast<dna::base>(static_cast<int>(value) ^ 1);
+		if (idx + 1 == data_end && value == procedural::TELOMERE_SEQ.back())
+			value = static_cast<dna::base>(static_cast<int>(value) ^ 1);
+
+		return value;
+	}
+};
+
+class procedural_person
+{
+	std::array<procedural_stream, 23> chroms_;
+
+public:
+	enum class sex
+	{
+		x,
+		y,
+	};
+
+	// Telomere lengths at full scale are drawn from [MIN_TELOMERE, MAX_TELOMERE) bases
+	static constexpr std::size_t MIN_TELOMERE = 4'000;
+	static constexpr std::size_t MAX_TELOMERE = 11'000;
+	// Telomeres shrink with the chromosomes, but by no more than this, so that they can
+	// still be detected and still vary from person to person
+	static constexpr double MIN_TELOMERE_SCALE = 0.02;
+
+	// Everyone generated from the same genome_seed has the same bases between their
+	// telomeres. Chromosomes are the length of the real ones with average telomeres, give
+	// or take each person's telomere lengths. scale shrinks every chromosome (and telomere)
+	// for faster tests. Throws std::invalid_argument for a scale so small that a chromosome
+	// wouldn't have room for its telomeres, which shrink no further than MIN_TELOMERE_SCALE.
+	procedural_person(std::uint64_t genome_seed, std::uint64_t person_seed, sex chromosome_23 = sex::x,
+			double scale = 1.0, std::size_t chunk_size = 1 << 16)
+	{
+		for (std::size_t i = 0; i < chroms_.size(); ++i)
+		{
+			const std::size_t length_idx = (i == 22 && chromosome_23 == sex::y) ? 23 : i;
+			const double telomere_scale = std::max(scale, MIN_TELOMERE_SCALE);
+			auto scaled = [](double length, double by) { return static_cast<std::size_t>(std::llround(length * by)); };
+
+			const std::size_t average_telomere = scaled((MIN_TELOMERE + MAX_TELOMERE) / 2.0, telomere_scale);
+			const std::size_t length = scaled(static_cast<double>(procedural::CHROMOSOME_LENGTHS[length_idx]), scale);
+			if (!(scale > 0) || length <= 2 * average_telomere)
+				throw std::invalid_argument("genome scale " + std::to_string(scale) + " leaves no room between the telomeres");
+			const std::size_t data_length = length - 2 * average_telomere;
+
+			const std::uint64_t r = procedural::mix(person_seed ^ procedural::mix(i + 1));
+			auto telomere = [&](unsigned bits) {
+				return scaled(static_cast<double>(MIN_TELOMERE + ((r >> bits) & 0xFFFF) % (MAX_TELOMERE - MIN_TELOMERE)), telomere_scale);
+			};
+
+			// The back telomere is rounded up to make the chromosome a whole # of bytes
+			const std::size_t front = telomere(0);
+			std::size_t back = telomere(16);
+			back += (dna::packed_size::value - (front + data_length + back) % dna::packed_size::value) % dna::packed_size::value;
+
+			const std::uint64_t key = procedural::mix(genome_seed) ^ procedural::mix(~static_cast<std::uint64_t>(length_idx));
+			chroms_[i] = procedural_stream(key, front, data_length, back, chunk_size);
+		}
+	}
+
+	const procedural_stream& chromosome(std::size_t chromosome_index) const
+	{
+		if (chromosome_index >= chroms_.size())
+			throw std::invalid_argument("index is out of range for the number of chromosomes available");
+
+		return chroms_[chromosome_index];
+	}
+
+	constexpr std::size_t chromosomes() const
+	{
+		return chroms_.size();
+	}
+};
@@ -0,0 +1,64 @@
+#include "catch.hpp"
+#include "procedural_stream.hpp"
+
+#include <comparator.hpp>
+
+TEST_CASE("Procedural streams generate any byte on demand", "[procedural]")
+{
+	// Telomere lengths that aren't a whole # of bytes exercise every alignment
+	for (std::size_t front : {60, 61, 62, 63})
+	{
+		procedural_stream helix(1234, front, 40'000 - front - 75, 75, 1000);
+		REQUIRE(helix.size() == 10'000);
+
+		std::vector<std::byte> all(static_cast<std::size_t>(helix.size()));
+		REQUIRE(helix.read_at(0, all) == all.size());
+
+		// The fast path agrees with generating base by base
+		std::size_t mismatches = 0;
+		for (std::size_t i = 0; i < all.size(); ++i)
+		{
+			const auto bases = dna::unpack(all[i]);
+			for (std::size_t j = 0; j < bases.size(); ++j)
+				mismatches += bases[j] != helix.base_at(4 * i + j);
+		}
+		CHECK(mismatches == 0);
+
+		// Reading sequentially and seeking give the same bytes as read_at
+		helix.seek(4321);
+		auto chunk = helix.read();
+		REQUIRE(chunk.size() == 1000 * dna::packed_size::value);
+		CHECK(std::equal(chunk.buffer().begin(), chunk.buffer().end(), all.begin() + 4321));
+
+		// And so does a fresh stream with the same parameters
+		procedural_stream again(1234, front, 40'000 - front - 75, 75);
+		std::vector<std::byte> copy(all.size());
+		again.read_at(0, copy);
+		CHECK(copy == all);
+
+		CHECK(dna::Comparator::getDataRange(helix) == helix.data_range());
+	}
+}
+
+TEST_CASE("Procedural people share a genome", "[procedural]")
+{
+	constexpr double scale = 1e-4;
+	procedural_person a(7, 1, procedural_person::sex::x, scale, 4096);
+	procedural_person b(7, 2, procedural_person::sex::x, scale, 4096);
+	procedural_person c(7, 3, procedural_person::sex::y, scale, 4096);
+
+	// Lengths follow the real chromosomes, give or take the telomeres
+	CHECK(a.chromosome(0).size() * 4 == Approx(24'896).margin(400));
+	CHECK(procedural_person(7, 1).chromosome(0).size() * 4 == Approx(248'956'422).margin(15'000));
+	CHECK(dna::Comparator::getSex(procedural_person(7, 1).chromosome(22)) == dna::Comparator::SexChromosome::X);
+	CHECK(dna::Comparator::getSex(procedural_person(7, 1, procedural_person::sex::y).chromosome(22)) == dna::Comparator::SexChromosome::Y);
+
+	// Telomeres differ, but nothing between them does
+	CHECK(a.chromosome(3).data_range() != b.chromosome(3).data_range());
+	CHECK(dna::Comparator::compare(a, b).empty());
+	CHECK(dna::Comparator::compare(a, c).empty());
+
+	// Too small for the telomeres, which stop shrinking at MIN_TELOMERE_SCALE
+	CHECK_THROWS_AS(procedural_person(7, 1, procedural_person::sex::x, 1e-6), std::invalid_argument);
+	CHECK_THROWS_AS(procedural_person(7, 1, procedural_person::sex::x, 0), std::invalid_argument);
+}
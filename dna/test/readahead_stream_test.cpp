@@ -0,0 +1,106 @@
+#include "catch.hpp"
+#include "fake_stream.hpp"
+#include "procedural_stream.hpp"
+
+#include <stdexcept>
+#include <vector>
+#include <comparator.hpp>
+#include <readahead_stream.hpp>
+
+namespace
+{
+
+template<dna::HelixStream H>
+std::vector<std::byte> read_all(H& helix)
+{
+	std::vector<std::byte> bytes;
+	for (auto seq = helix.read(); seq.size() > 0; seq = helix.read())
+	{
+		for (std::size_t i = 0; i < seq.size() / dna::packed_size::value; ++i)
+			bytes.push_back(seq.buffer()[i]);
+	}
+	return bytes;
+}
+
+// Fails on its third read
+class failing_stream
+{
+	fake_stream helix_;
+	int reads_ = 0;
+
+public:
+	explicit failing_stream(fake_stream helix) :
+			helix_(std::move(helix))
+	{ }
+
+	void seek(long offset)
+	{
+		helix_.seek(offset);
+	}
+
+	long size() const
+	{
+		return helix_.size();
+	}
+
+	auto read()
+	{
+		if (++reads_ == 3)
+			throw std::runtime_error("storage went away");
+		return helix_.read();
+	}
+};
+
+}
+
+TEST_CASE("Read ahead streams hand out the same bytes in the same order", "[readahead]")
+{
+	const procedural_stream source(7, 13, 40'000, 15);
+	std::vector<std::byte> expected(static_cast<std::size_t>(source.size()));
+	source.read_at(0, expected);
+
+	SECTION("Positional streams are read in chunks of the given size")
+	{
+		dna::readahead_stream helix(source, 3, 1000);
+		CHECK(helix.size() == source.size());
+		CHECK(read_all(helix) == expected);
+
+		// Seeking throws away whatever was read ahead
+		helix.read();
+		helix.seek(1234);
+		auto seq = helix.read();
+		REQUIRE(seq.size() == 1000 * dna::packed_size::value);
+		CHECK(std::equal(seq.buffer().begin(), seq.buffer().end(), expected.begin() + 1234));
+
+		// Copies carry on from the same place
+		dna::readahead_stream copy(helix);
+		CHECK(copy.read().buffer()[0] == expected[2234]);
+	}
+
+	SECTION("Other streams are read with their own read()")
+	{
+		dna::readahead_stream helix(fake_stream(expected, 999), 2);
+		CHECK(read_all(helix) == expected);
+
+		helix.seek(5000);
+		CHECK(helix.read().buffer()[0] == expected[5000]);
+	}
+
+	SECTION("Errors are rethrown by the read that would have returned the chunk")
+	{
+		dna::readahead_stream helix(failing_stream(fake_stream(expected, 999)));
+		helix.read();
+		helix.read();
+		CHECK_THROWS_AS(helix.read(), std::runtime_error);
+	}
+}
+
+TEST_CASE("Reading ahead doesn't change a comparison", "[readahead]")
+{
+	static_assert(dna::Person<dna::readahead_person<procedural_person>>);
+
+	const procedural_person a(3, 1, procedural_person::sex::x, 1e-3, 4096);
+	const procedural_person b(3, 2, procedural_person::sex::x, 1e-3, 4096);
+
+	CHECK(dna::Comparator::compare(dna::readahead_person(a, 2, 512), dna::readahead_person(b)) == dna::Comparator::compare(a, b));
+}
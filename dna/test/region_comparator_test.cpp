@@ -0,0 +1,153 @@
+#include "catch.hpp"
+#include "fake_person.hpp"
+#include "sequence_builder.hpp"
+
+#include <region_comparator.hpp>
+
+namespace
+{
+
+constexpr std::size_t TELOMERE_LEN = 600;
+constexpr std::size_t CHROMOSOME = 5;
+
+// 23 copies of filler, except for CHROMOSOME
+fake_person make_person(const std::vector<dna::base>& chromosome, std::size_t chunk_size = 512)
+{
+	const auto filler = pack_bases(concat({telomeres(TELOMERE_LEN), random_bases(400, 1)}));
+
+	std::array<std::vector<std::byte>, 23> data;
+	for (std::size_t i = 0; i < data.size(); i++)
+		data[i] = i == CHROMOSOME ? pack_bases(chromosome) : filler;
+	return fake_person(data, chunk_size);
+}
+
+}
+
+TEST_CASE("A region can be compared against a cohort", "[region]")
+{
+	const auto body = random_bases(6000, 34);
+	const auto source = make_person(concat({telomeres(TELOMERE_LEN), body, telomeres(TELOMERE_LEN)}));
+
+	const std::size_t start = TELOMERE_LEN + 2000;
+	const std::size_t end = TELOMERE_LEN + 2500;
+	dna::RegionComparator<> region(source, CHROMOSOME, start, end);
+	REQUIRE(region.region().size() == 500);
+
+	SECTION("Identical person")
+	{
+		auto result = region.compare(source);
+		CHECK(result.status == dna::RegionStatus::Found);
+		CHECK(result.location == dna::Difference::subsection{start, end});
+		CHECK(result.differences.empty());
+	}
+
+	SECTION("Position is measured from the end of the telomeres")
+	{
+		auto snp = body;
+		snp[2100] = snp[2100] == dna::A ? dna::G : dna::A;
+		auto result = region.compare(make_person(concat({telomeres(300), snp, telomeres(900)}), 64));
+
+		CHECK(result.status == dna::RegionStatus::Found);
+		CHECK(result.location == dna::Difference::subsection{300 + 2000, 300 + 2500});
+		REQUIRE(result.differences.size() == 1);
+		CHECK(result.differences[0].chromosome_idx == CHROMOSOME);
+		CHECK(result.differences[0].kind == dna::DifferenceKind::Snp);
+		CHECK(result.differences[0].person_a == dna::Difference::subsection{start + 100, start + 101});
+		CHECK(result.differences[0].person_b == dna::Difference::subsection{300 + 2100, 300 + 2101});
+	}
+
+	SECTION("Indels before the region move it")
+	{
+		auto inserted = body;
+		const auto extra = random_bases(40, 35);
+		inserted.insert(inserted.begin() + 1000, extra.begin(), extra.end());
+		auto result = region.compare(make_person(concat({telomeres(TELOMERE_LEN), inserted, telomeres(TELOMERE_LEN)})));
+
+		CHECK(result.status == dna::RegionStatus::Found);
+		CHECK(result.location == dna::Difference::subsection{start + 40, end + 40});
+		CHECK(result.differences.empty());
+	}
+
+	SECTION("Indels within the region")
+	{
+		auto deleted = body;
+		deleted.erase(deleted.begin() + 2200, deleted.begin() + 2212);
+		auto result = region.compare(make_person(concat({telomeres(TELOMERE_LEN), deleted, telomeres(TELOMERE_LEN)})));
+
+		CHECK(result.status == dna::RegionStatus::Found);
+		CHECK(result.location == dna::Difference::subsection{start, end - 12});
+		REQUIRE(result.differences.size() == 1);
+		CHECK(result.differences[0].kind == dna::DifferenceKind::Deletion);
+		CHECK(result.differences[0].a_length() == 12);
+	}
+
+	SECTION("Comparisons cut short say so")
+	{
+		auto snps = body;
+		for (std::size_t pos : {2100, 2200, 2300})
+			snps[pos] = snps[pos] == dna::A ? dna::G : dna::A;
+		const auto person = make_person(concat({telomeres(TELOMERE_LEN), snps, telomeres(TELOMERE_LEN)}));
+
+		auto result = region.compare(person);
+		CHECK(result.comparison.complete());
+		CHECK(result.differences.size() == 3);
+
+		dna::RegionOptions options;
+		options.compare.max_differences = 2;
+		dna::RegionComparator<> limited(source, CHROMOSOME, start, end, options);
+		result = limited.compare(person);
+		CHECK(result.status == dna::RegionStatus::Found);
+		CHECK(result.comparison.reason == dna::StopReason::MaxDifferences);
+		CHECK(result.comparison.person_a_position == start + 300);
+		CHECK(result.differences.size() == 2);
+	}
+
+	SECTION("No telomere to measure from")
+	{
+		auto result = region.compare(make_person(concat({body, telomeres(TELOMERE_LEN)})));
+		CHECK(result.status == dna::RegionStatus::Unanchored);
+	}
+
+	SECTION("Region missing from the person")
+	{
+		auto result = region.compare(make_person(concat({telomeres(TELOMERE_LEN), random_bases(6000, 36), telomeres(TELOMERE_LEN)})));
+		CHECK(result.status == dna::RegionStatus::NotFound);
+	}
+}
+
+TEST_CASE("A cohort is compared in parallel", "[region]")
+{
+	const auto body = random_bases(6000, 37);
+
+	std::vector<fake_person> cohort;
+	for (std::size_t i = 0; i < 12; ++i)
+	{
+		auto mutated = body;
+		mutated[3000 + i] = mutated[3000 + i] == dna::C ? dna::T : dna::C;
+		cohort.push_back(make_person(concat({telomeres(TELOMERE_LEN + 12 * i), mutated, telomeres(TELOMERE_LEN)}), 128));
+	}
+	cohort.push_back(make_person(concat({body, telomeres(TELOMERE_LEN)})));
+
+	const auto source = make_person(concat({telomeres(TELOMERE_LEN), body, telomeres(TELOMERE_LEN)}));
+	dna::RegionOptions options;
+	options.threads = 3;
+	dna::RegionComparator<> region(source, dna::Difference(CHROMOSOME, TELOMERE_LEN + 2900, TELOMERE_LEN + 3100, 0, 0), dna::Sample::A, options);
+
+	auto results = region.compare(cohort);
+	REQUIRE(results.size() == cohort.size());
+	for (std::size_t i = 0; i < 12; ++i)
+	{
+		REQUIRE(results[i].differences.size() == 1);
+		CHECK(results[i].differences[0].person_b.first == TELOMERE_LEN + 12 * i + 3000 + i);
+	}
+	CHECK(results.back().status == dna::RegionStatus::Unanchored);
+}
+
+TEST_CASE("A region must be anchored by telomeres", "[region]")
+{
+	const auto body = random_bases(2000, 38);
+
+	CHECK_THROWS_AS(dna::RegionComparator<>(make_person(concat({body, telomeres(TELOMERE_LEN)})), CHROMOSOME, 100, 200), std::invalid_argument);
+	CHECK_THROWS_AS(dna::RegionComparator<>(make_person(concat({telomeres(TELOMERE_LEN), body})), CHROMOSOME, 100, 200), std::invalid_argument);
+	CHECK_THROWS_AS(dna::RegionComparator<>(make_person(concat({telomeres(TELOMERE_LEN), body})), CHROMOSOME, 700, 5000), std::invalid_argument);
+}
@@ -0,0 +1,56 @@
+#pragma once
+
+#include <base.hpp>
+#include <cstddef>
+#include <random>
+#include <stdexcept>
+#include <vector>
+
+// Helpers for building base sequences in tests and packing them the way HelixStreams store them
+
+inline std::vector<dna::base> random_bases(std::size_t count, unsigned seed)
+{
+	std::mt19937 rng(seed);
+	std::uniform_int_distribution<int> dist(0, 3);
+
+	std::vector<dna::base> bases(count);
+	for (auto& b : bases)
+		b = static_cast<dna::base>(dist(rng));
+	return bases;
+}
+
+// A base that differs from b, for planting a substitution
+inline dna::base other(dna::base b)
+{
+	return static_cast<dna::base>((static_cast<int>(b) + 1) % 4);
+}
+
+// count bases of repeating TTAGGG, starting phase bases into the repeat
+inline std::vector<dna::base> telomeres(std::size_t count, std::size_t phase = 0)
+{
+	static constexpr dna::base seq[] = {dna::T, dna::T, dna::A, dna::G, dna::G, dna::G};
+
+	std::vector<dna::base> bases(count);
+	for (std::size_t i = 0; i < count; ++i)
+		bases[i] = seq[(i + phase) % 6];
+	return bases;
+}
+
+inline std::vector<dna::base> concat(std::initializer_list<std::vector<dna::base>> parts)
+{
+	std::vector<dna::base> bases;
+	for (const auto& part : parts)
+		bases.insert(bases.end(), part.begin(), part.end());
+	return bases;
+}
+
+inline std::vector<std::byte> pack_bases(const std::vector<dna::base>& bases)
+{
+	if (bases.size() % dna::packed_size::value != 0)
+		throw std::invalid_argument("sequence length must be a whole number of bytes");
+
+	std::vector<std::byte> bytes(bases.size() / dna::packed_size::value);
+	for (std::size_t i = 0; i < bytes.size(); ++i)
+		bytes[i] = dna::pack(bases[4 * i], bases[4 * i + 1], bases[4 * i + 2], bases[4 * i + 3]);
+	return bytes;
+}
@@ -0,0 +1,39 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <unistd.h>
+
+// A file holding the given bytes, deleted again when it goes out of scope
+class temporary_file
+{
+	std::filesystem::path path_;
+
+public:
+	explicit temporary_file(const std::vector<std::byte>& bytes)
+	{
+		static std::atomic<unsigned> count{0};
+		path_ = std::filesystem::temp_directory_path() / ("dna_" + std::to_string(::getpid()) + "_" + std::to_string(count++));
+
+		std::ofstream out(path_, std::ios::binary);
+		out.write(reinterpret_cast<const char*>(bytes.data()), static_cast<std::streamsize>(bytes.size()));
+	}
+
+	temporary_file(const temporary_file&) = delete;
+	temporary_file& operator=(const temporary_file&) = delete;
+
+	~temporary_file()
+	{
+		std::error_code ignored;
+		std::filesystem::remove(path_, ignored);
+	}
+
+	std::string path() const
+	{
+		return path_.string();
+	}
+};
@@ -0,0 +1,57 @@
+#include "catch.hpp"
+
+#include <sstream>
+#include <thread>
+#include <trace.hpp>
+
+TEST_CASE("Trace spans are recorded per thread and exported as Chrome JSON", "[trace]")
+{
+	auto& recorder = dna::trace::recorder::instance();
+	recorder.clear();
+
+	// Nothing is recorded until the recorder is enabled
+	{
+		dna::trace::scope ignored("ignored");
+	}
+
+	recorder.enable();
+	{
+		dna::trace::scope outer("outer");
+		dna::trace::scope inner("inner", 3);
+	}
+	std::thread([] {
+		// Enough to fill more than one block
+		for (int i = 0; i < 10'000; ++i)
+			dna::trace::scope span("worker", 1);
+	}).join();
+	recorder.enable(false);
+
+	std::size_t buffers = 0;
+	std::size_t events = 0;
+	std::size_t ignored = 0;
+	bool nested = false;
+	recorder.for_each_buffer([&](const dna::trace::thread_buffer& buffer) {
+		++buffers;
+		buffer.for_each([&](const dna::trace::event& e) {
+			++events;
+			ignored += std::string(e.name) == "ignored";
+			if (std::string(e.name) == "inner")
+				nested = e.chromosome_idx == 3;
+		});
+	});
+	CHECK(buffers == 2);
+	CHECK(events == 10'002);
+	CHECK(ignored == 0);
+	CHECK(nested);
+
+	std::ostringstream json;
+	recorder.write_chrome_json(json);
+	CHECK(json.str().starts_with("{\"traceEvents\":["));
+	CHECK(json.str().find("\"name\":\"inner\",\"ph\":\"X\"") != std::string::npos);
+	CHECK(json.str().find("\"args\":{\"chromosome\":3}") != std::string::npos);
+
+	recorder.clear();
+	std::size_t cleared = 0;
+	recorder.for_each_buffer([&](const dna::trace::thread_buffer&) { ++cleared; });
+	CHECK(cleared == 0);
+}
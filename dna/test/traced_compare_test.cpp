@@ -0,0 +1,43 @@
+#include "catch.hpp"
+#include "procedural_stream.hpp"
+
+#include <map>
+#include <set>
+#include <string>
+#include <comparator.hpp>
+#include <trace.hpp>
+
+// Built into dna_trace_test, with DNA_TRACE defined, so the library's spans are compiled in
+
+TEST_CASE("A traced comparison records spans for every chromosome and phase", "[trace]")
+{
+	const procedural_person a(7, 1, procedural_person::sex::x, 1e-4, 4096);
+	const procedural_person b(7, 2, procedural_person::sex::x, 1e-4, 4096);
+
+	auto& recorder = dna::trace::recorder::instance();
+	recorder.clear();
+	recorder.enable();
+	dna::Comparator::compare(a, b);
+	recorder.enable(false);
+
+	std::map<std::string, std::set<std::size_t>> chromosomes;
+	recorder.for_each_buffer([&](const dna::trace::thread_buffer& buffer) {
+		buffer.for_each([&](const dna::trace::event& e) {
+			chromosomes[e.name].insert(e.chromosome_idx);
+		});
+	});
+	recorder.clear();
+
+	// Sex chromosomes are told apart by length, which a scaled down one doesn't have, so
+	// only the autosomes are compared
+	std::set<std::size_t> all;
+	for (std::size_t i = 0; i < 22; ++i)
+		all.insert(i);
+
+	CHECK(chromosomes["compare"] == std::set<std::size_t>{dna::trace::NO_CHROMOSOME});
+	CHECK(chromosomes["chromosome"] == all);
+	CHECK(chromosomes["telomeres"] == all);
+	CHECK(chromosomes["scan"] == all);
+	// Reads come from the cursors, which don't know which chromosome they're reading
+	CHECK(chromosomes.contains("read"));
+}
@@ -0,0 +1,255 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <vector>
+
+// Spans of time spent in each phase of a comparison (per chromosome, reading, telomere
+// detection, scanning, aligning), for finding out where a slow comparison went. Spans are
+// viewed as a timeline by exporting them as Chrome trace JSON and loading that into
+// chrome://tracing or https://ui.perfetto.dev.
+//
+// The library only records spans when built with DNA_TRACE defined (the DNA_TRACE CMake
+// option); otherwise DNA_TRACE_SCOPE compiles to nothing. Even then, nothing is recorded
+// until recorder::instance().enable() is called.
+//
+// Each thread records into its own buffer, so recording never takes a lock: a buffer is a
+// list of fixed-size blocks that only its own thread appends to, publishing each event
+// with a release store, so it can be exported while other threads are still recording.
+
+namespace dna
+{
+
+namespace trace
+{
+
+// Marks a span that isn't about any one chromosome
+inline constexpr std::size_t NO_CHROMOSOME = SIZE_MAX;
+
+struct event
+{
+	const char* name; // must outlive the recorder, e.g. a string literal
+	std::uint64_t start_ns;
+	std::uint64_t duration_ns;
+	std::size_t chromosome_idx;
+};
+
+// Events recorded by one thread
+class thread_buffer
+{
+	static constexpr std::size_t BLOCK_EVENTS = 4096;
+
+	struct block
+	{
+		event events[BLOCK_EVENTS];
+		std::atomic<std::size_t> count{0};
+		std::atomic<block*> next{nullptr};
+	};
+
+	std::unique_ptr<block> head_;
+	block* tail_;
+	std::uint32_t thread_id_;
+
+public:
+	explicit thread_buffer(std::uint32_t thread_id) :
+			head_(std::make_unique<block>()),
+			tail_(head_.get()),
+			thread_id_(thread_id)
+	{ }
+
+	thread_buffer(const thread_buffer&) = delete;
+	thread_buffer& operator=(const thread_buffer&) = delete;
+
+	~thread_buffer()
+	{
+		for (block* b = head_->next.load(); b != nullptr;)
+		{
+			block* next = b->next.load();
+			delete b;
+			b = next;
+		}
+	}
+
+	std::uint32_t thread_id() const noexcept
+	{
+		return thread_id_;
+	}
+
+	// Only ever called by the thread that owns the buffer
+	void push(const event& e)
+	{
+		std::size_t count = tail_->count.load(std::memory_order_relaxed);
+		if (count == BLOCK_EVENTS)
+		{
+			auto* next = new block();
+			tail_->next.store(next, std::memory_order_release);
+			tail_ = next;
+			count = 0;
+		}
+
+		tail_->events[count] = e;
+		tail_->count.store(count + 1, std::memory_order_release);
+	}
+
+	// Calls f with every event published so far. Safe to call from any thread.
+	template<typename F>
+	void for_each(F&& f) const
+	{
+		for (const block* b = head_.get(); b != nullptr; b = b->next.load(std::memory_order_acquire))
+		{
+			const std::size_t count = b->count.load(std::memory_order_acquire);
+			for (std::size_t i = 0; i < count; ++i)
+				f(b->events[i]);
+		}
+	}
+};
+
+// Owns every thread's buffer. A thread's buffer is created (under a lock) the first time
+// it records anything, and kept until the recorder is cleared.
+class recorder
+{
+	using clock = std::chrono::steady_clock;
+
+	std::atomic<bool> enabled_;
+	// Bumped by clear(), so threads know to fetch a new buffer
+	std::atomic<std::uint64_t> generation_;
+	clock::time_point epoch_;
+	std::mutex mutex_;
+	std::vector<std::shared_ptr<thread_buffer>> buffers_;
+
+	recorder() :
+			enabled_(false),
+			generation_(0),
+			epoch_(clock::now())
+	{ }
+
+public:
+	static recorder& instance()
+	{
+		static recorder r;
+		return r;
+	}
+
+	void enable(bool enabled = true) noexcept
+	{
+		enabled_.store(enabled, std::memory_order_relaxed);
+	}
+
+	bool enabled() const noexcept
+	{
+		return enabled_.load(std::memory_order_relaxed);
+	}
+
+	std::uint64_t now() const noexcept
+	{
+		return static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(clock::now() - epoch_).count());
+	}
+
+	void record(const event& e)
+	{
+		thread_local std::shared_ptr<thread_buffer> buffer;
+		thread_local std::uint64_t generation = UINT64_MAX;
+
+		if (const auto current = generation_.load(std::memory_order_acquire); generation != current)
+		{
+			std::lock_guard lock(mutex_);
+			buffer = std::make_shared<thread_buffer>(static_cast<std::uint32_t>(buffers_.size() + 1));
+			buffers_.push_back(buffer);
+			generation = current;
+		}
+
+		buffer->push(e);
+	}
+
+	// Forgets everything recorded so far. Threads still recording carry on into buffers
+	// that are no longer exported, until their next span.
+	void clear()
+	{
+		std::lock_guard lock(mutex_);
+		buffers_.clear();
+		generation_.fetch_add(1, std::memory_order_acq_rel);
+	}
+
+	// Calls f with each thread's buffer
+	template<typename F>
+	void for_each_buffer(F&& f)
+	{
+		std::lock_guard lock(mutex_);
+		for (const auto& buffer : buffers_)
+			f(*buffer);
+	}
+
+	// Writes every span as Chrome trace JSON: one complete ("X") event per span, with
+	// times in microseconds
+	void write_chrome_json(std::ostream& os)
+	{
+		os << "{\"traceEvents\":[";
+		bool first = true;
+		for_each_buffer([&](const thread_buffer& buffer) {
+			buffer.for_each([&](const event& e) {
+				os << (first ? "\n" : ",\n");
+				first = false;
+				os << "{\"name\":\"" << e.name << "\",\"ph\":\"X\",\"pid\":1,\"tid\":" << buffer.thread_id()
+						<< ",\"ts\":" << e.start_ns / 1000 << '.' << (e.start_ns / 100) % 10
+						<< ",\"dur\":" << e.duration_ns / 1000 << '.' << (e.duration_ns / 100) % 10;
+				if (e.chromosome_idx != NO_CHROMOSOME)
+					os << ",\"args\":{\"chromosome\":" << e.chromosome_idx << '}';
+				os << '}';
+			});
+		});
+		os << "\n],\"displayTimeUnit\":\"ns\"}\n";
+	}
+};
+
+// Records the time from its construction to its destruction, if the recorder was enabled
+// when it was constructed
+class scope
+{
+	const char* name_;
+	std::size_t chromosome_idx_;
+	std::uint64_t start_;
+	bool active_;
+
+public:
+	explicit scope(const char* name, std::size_t chromosome_idx = NO_CHROMOSOME) :
+			name_(name),
+			chromosome_idx_(chromosome_idx),
+			start_(0),
+			active_(recorder::instance().enabled())
+	{
+		if (active_)
+			start_ = recorder::instance().now();
+	}
+
+	scope(const scope&) = delete;
+	scope& operator=(const scope&) = delete;
+
+	~scope()
+	{
+		if (active_)
+		{
+			auto& r = recorder::instance();
+			r.record(event{name_, start_, r.now() - start_, chromosome_idx_});
+		}
+	}
+};
+
+}
+
+}
+
+#define DNA_TRACE_CONCAT_IMPL(x, y) x##y
+#define DNA_TRACE_CONCAT(x, y) DNA_TRACE_CONCAT_IMPL(x, y)
+
+// DNA_TRACE_SCOPE(name) or DNA_TRACE_SCOPE(name, chromosome_idx) records a span from here
+// to the end of the enclosing block
+#ifdef DNA_TRACE
+#define DNA_TRACE_SCOPE(...) ::dna::trace::scope DNA_TRACE_CONCAT(dna_trace_scope_, __LINE__)(__VA_ARGS__)
+#else
+#define DNA_TRACE_SCOPE(...) static_cast<void>(0)
+#endif